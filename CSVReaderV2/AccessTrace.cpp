@@ -0,0 +1,53 @@
+//
+//  AccessTrace.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "AccessTrace.hpp"
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include "ReadCSVFile.hpp"
+
+vector<string> readAccessTrace(const string &path)
+{
+  vector<string> tables;
+  string content;
+  if (!readFileContent(path, content)) {
+    return tables;
+  }
+  unordered_set<string> seen;
+  istringstream lines(content);
+  string line;
+  while (getline(lines, line)) {
+    string table;
+    istringstream(line.substr(0, line.find('#'))) >> table;
+    if (table.size() > 0 && seen.insert(table).second) {
+      tables.push_back(table);
+    }
+  }
+  return tables;
+}
+
+vector<size_t> orderByAccessTrace(const vector<string> &names, const vector<string> &trace)
+{
+  unordered_map<string, size_t> ranks;
+  for (size_t i = 0; i < trace.size(); ++i) {
+    ranks.insert(make_pair(trace[i], i));
+  }
+  // tables the trace doesn't know, new ones or ones nobody touched, share the last rank
+  auto rank = [&](size_t index) {
+    auto found = ranks.find(names[index]);
+    return found == ranks.end() ? trace.size() : found->second;
+  };
+  vector<size_t> order(names.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rank(a) < rank(b); });
+  return order;
+}
@@ -0,0 +1,28 @@
+//
+//  AccessTrace.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef AccessTrace_hpp
+#define AccessTrace_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Reads the trace a game built with DATA_ACCESS_TRACE writes, one
+// "table [row ...]" per line in the order the tables were first used,
+// # starts a comment. Returns the tables in that order, each once. A missing
+// file is an empty trace, so the first build can generate the recording code.
+vector<string> readAccessTrace(const string &path);
+
+// positions of names ordered by the trace: traced ones first in trace order,
+// then the rest in their current order
+vector<size_t> orderByAccessTrace(const vector<string> &names, const vector<string> &trace);
+
+#endif /* AccessTrace_hpp */
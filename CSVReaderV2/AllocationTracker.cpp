@@ -0,0 +1,264 @@
+//
+//  AllocationTracker.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "AllocationTracker.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sys/resource.h>
+
+using namespace std;
+
+static atomic<bool> _enabled(false);
+static atomic<uint64_t> _totalAllocations(0);
+static atomic<uint64_t> _totalBytes(0);
+static atomic<int64_t> _liveBytes(0);
+static atomic<int64_t> _peakLiveBytes(0);
+static thread_local uint64_t _threadAllocations = 0;
+static thread_local uint64_t _threadBytes = 0;
+
+#ifdef CSVREADER_ALLOC_STATS
+// in front of every block operator new hands out, whether tracking is on or not,
+// so delete only takes back what was counted
+struct AllocationHeader
+{
+  // what malloc returned, aligned blocks start further in
+  void *base;
+  // 0 when the block was allocated while tracking was off
+  size_t countedBytes;
+};
+static const size_t kHeaderSize = (sizeof(AllocationHeader) + alignof(max_align_t) - 1) / alignof(max_align_t) * alignof(max_align_t);
+
+static void _recordAllocation(size_t size)
+{
+  _threadAllocations++;
+  _threadBytes += size;
+  _totalAllocations.fetch_add(1, memory_order_relaxed);
+  _totalBytes.fetch_add(size, memory_order_relaxed);
+  int64_t live = _liveBytes.fetch_add(size, memory_order_relaxed) + size;
+  int64_t peak = _peakLiveBytes.load(memory_order_relaxed);
+  while (live > peak && !_peakLiveBytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {
+  }
+}
+
+static void *_allocate(size_t size, size_t alignment = alignof(max_align_t))
+{
+  size = size > 0 ? size : 1;
+  // the header sits right before the block, an alignment past malloc's needs room for it too
+  size_t offset = max(kHeaderSize, alignment);
+  if (size > SIZE_MAX - offset - alignment) {
+    return nullptr;
+  }
+  void *base = malloc(size + offset + (alignment > alignof(max_align_t) ? alignment : 0));
+  if (base == nullptr) {
+    return nullptr;
+  }
+  uintptr_t address = ((uintptr_t)base + offset + alignment - 1) / alignment * alignment;
+  AllocationHeader *header = (AllocationHeader *)(address - sizeof(AllocationHeader));
+  header->base = base;
+  header->countedBytes = 0;
+  if (_enabled.load(memory_order_relaxed)) {
+    header->countedBytes = size;
+    _recordAllocation(size);
+  }
+  return (void *)address;
+}
+
+static void _deallocate(void *pointer)
+{
+  if (pointer == nullptr) {
+    return;
+  }
+  AllocationHeader *header = (AllocationHeader *)((uintptr_t)pointer - sizeof(AllocationHeader));
+  if (header->countedBytes > 0) {
+    _liveBytes.fetch_sub(header->countedBytes, memory_order_relaxed);
+  }
+  free(header->base);
+}
+
+void *operator new(size_t size)
+{
+  void *pointer = _allocate(size);
+  if (pointer == nullptr) {
+    throw bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new[](size_t size)
+{
+  void *pointer = _allocate(size);
+  if (pointer == nullptr) {
+    throw bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept
+{
+  return _allocate(size);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept
+{
+  return _allocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete(void *pointer, const nothrow_t &) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete[](void *pointer, const nothrow_t &) noexcept
+{
+  _deallocate(pointer);
+}
+
+#ifdef __cpp_aligned_new
+void *operator new(size_t size, align_val_t alignment)
+{
+  void *pointer = _allocate(size, (size_t)alignment);
+  if (pointer == nullptr) {
+    throw bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new[](size_t size, align_val_t alignment)
+{
+  void *pointer = _allocate(size, (size_t)alignment);
+  if (pointer == nullptr) {
+    throw bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new(size_t size, align_val_t alignment, const nothrow_t &) noexcept
+{
+  return _allocate(size, (size_t)alignment);
+}
+
+void *operator new[](size_t size, align_val_t alignment, const nothrow_t &) noexcept
+{
+  return _allocate(size, (size_t)alignment);
+}
+
+void operator delete(void *pointer, align_val_t) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete[](void *pointer, align_val_t) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete(void *pointer, size_t, align_val_t) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete[](void *pointer, size_t, align_val_t) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete(void *pointer, align_val_t, const nothrow_t &) noexcept
+{
+  _deallocate(pointer);
+}
+
+void operator delete[](void *pointer, align_val_t, const nothrow_t &) noexcept
+{
+  _deallocate(pointer);
+}
+#endif
+#endif
+
+bool AllocationTracker::isAvailable()
+{
+#ifdef CSVREADER_ALLOC_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AllocationTracker::setEnabled(bool enabled)
+{
+  _enabled = enabled && isAvailable();
+}
+
+bool AllocationTracker::isEnabled()
+{
+  return _enabled.load(memory_order_relaxed);
+}
+
+uint64_t AllocationTracker::threadAllocations()
+{
+  return _threadAllocations;
+}
+
+uint64_t AllocationTracker::threadAllocatedBytes()
+{
+  return _threadBytes;
+}
+
+uint64_t AllocationTracker::totalAllocations()
+{
+  return _totalAllocations;
+}
+
+uint64_t AllocationTracker::totalAllocatedBytes()
+{
+  return _totalBytes;
+}
+
+int64_t AllocationTracker::liveBytes()
+{
+  return _liveBytes;
+}
+
+int64_t AllocationTracker::peakLiveBytes()
+{
+  return _peakLiveBytes;
+}
+
+size_t AllocationTracker::peakResidentBytes()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024;
+#endif
+}
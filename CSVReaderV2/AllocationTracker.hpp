@@ -0,0 +1,40 @@
+//
+//  AllocationTracker.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef AllocationTracker_hpp
+#define AllocationTracker_hpp
+
+#include <stdio.h>
+#include <cstddef>
+#include <cstdint>
+
+// Counts every global operator new/delete once enabled. The operators are
+// only replaced in builds with CSVREADER_ALLOC_STATS (the Debug configuration),
+// elsewhere nothing is counted and allocations go straight to the library.
+// In those builds every block carries a 16 byte header with the size it was
+// counted with, tracking or not, so the numbers are requested bytes and live
+// bytes only cover memory allocated after tracking was turned on.
+class AllocationTracker
+{
+public:
+  static bool isAvailable();
+  static void setEnabled(bool enabled);
+  static bool isEnabled();
+  
+  // monotonic counters of the calling thread, diff them around a phase
+  static uint64_t threadAllocations();
+  static uint64_t threadAllocatedBytes();
+  
+  static uint64_t totalAllocations();
+  static uint64_t totalAllocatedBytes();
+  static int64_t liveBytes();
+  static int64_t peakLiveBytes();
+  static size_t peakResidentBytes();
+};
+
+#endif /* AllocationTracker_hpp */
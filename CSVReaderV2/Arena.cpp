@@ -0,0 +1,89 @@
+//
+//  Arena.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "Arena.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+static atomic<uint64_t> _totalBlockCount(0);
+static atomic<uint64_t> _totalBlockBytes(0);
+
+Arena::Arena(size_t blockSize)
+{
+  _blockSize = blockSize;
+  _used = 0;
+  _bytesAllocated = 0;
+}
+
+Arena::~Arena()
+{
+  release();
+  for (Block &block : _blocks) {
+    free(block.data);
+  }
+}
+
+void *Arena::allocate(size_t size, size_t alignment)
+{
+  if (_blocks.size() > 0) {
+    Block &block = _blocks.back();
+    size_t offset = (_used + alignment - 1) & ~(alignment - 1);
+    if (offset + size <= block.size) {
+      _used = offset + size;
+      _bytesAllocated += size;
+      return block.data + offset;
+    }
+  }
+  // oversized requests get a block of their own
+  size_t blockSize = max(_blockSize, size + alignment);
+  Block block = {static_cast<char *>(malloc(blockSize)), blockSize};
+  if (block.data == nullptr) {
+    throw bad_alloc();
+  }
+  _blocks.push_back(block);
+  _totalBlockCount.fetch_add(1, memory_order_relaxed);
+  _totalBlockBytes.fetch_add(blockSize, memory_order_relaxed);
+  size_t offset = (reinterpret_cast<uintptr_t>(block.data) + alignment - 1) & ~(alignment - 1);
+  offset -= reinterpret_cast<uintptr_t>(block.data);
+  _used = offset + size;
+  _bytesAllocated += size;
+  return block.data + offset;
+}
+
+StringRef Arena::copyString(const char *text, size_t size)
+{
+  char *data = static_cast<char *>(allocate(size, 1));
+  memcpy(data, text, size);
+  return StringRef(data, size);
+}
+
+uint64_t Arena::totalBlockCount()
+{
+  return _totalBlockCount;
+}
+
+uint64_t Arena::totalBlockBytes()
+{
+  return _totalBlockBytes;
+}
+
+void Arena::release()
+{
+  for (auto iter = _destructors.rbegin(); iter != _destructors.rend(); ++iter) {
+    iter->destroy(iter->object);
+  }
+  _destructors.clear();
+  while (_blocks.size() > 1) {
+    free(_blocks.back().data);
+    _blocks.pop_back();
+  }
+  _used = 0;
+  _bytesAllocated = 0;
+}
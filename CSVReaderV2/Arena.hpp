@@ -0,0 +1,74 @@
+//
+//  Arena.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef Arena_hpp
+#define Arena_hpp
+
+#include <stdint.h>
+#include <stdio.h>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "StringRef.hpp"
+
+using namespace std;
+
+// Bump allocator for objects that all die together. Memory is handed out
+// from large blocks and nothing is freed individually, release() runs the
+// pending destructors in reverse order and recycles the first block.
+class Arena
+{
+private:
+  struct Block
+  {
+    char *data;
+    size_t size;
+  };
+  struct Destructor
+  {
+    void (*destroy)(void *object);
+    void *object;
+  };
+  vector<Block> _blocks;
+  vector<Destructor> _destructors;
+  size_t _blockSize;
+  size_t _used;
+  size_t _bytesAllocated;
+  
+  template<typename T> static void _destroy(void *object) {
+    static_cast<T *>(object)->~T();
+  }
+public:
+  Arena(size_t blockSize = 64 * 1024);
+  ~Arena();
+  Arena(const Arena &other) = delete;
+  Arena& operator=(const Arena &other) = delete;
+  
+  void *allocate(size_t size, size_t alignment = alignof(max_align_t));
+  void release();
+  // copies the characters into the arena, the result lives until release()
+  StringRef copyString(const char *text, size_t size);
+  StringRef copyString(const string &text) { return copyString(text.data(), text.size()); }
+  size_t bytesAllocated() const { return _bytesAllocated; }
+  size_t blockCount() const { return _blocks.size(); }
+  // blocks every arena ever requested from malloc, for allocation tracking
+  static uint64_t totalBlockCount();
+  static uint64_t totalBlockBytes();
+  
+  template<typename T, typename... Args> T *make(Args&&... args) {
+    T *object = new (allocate(sizeof(T), alignof(T))) T(forward<Args>(args)...);
+    if (!is_trivially_destructible<T>::value) {
+      _destructors.push_back({&_destroy<T>, object});
+    }
+    return object;
+  }
+};
+
+#endif /* Arena_hpp */
@@ -0,0 +1,431 @@
+//
+//  ArrowExport.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "ArrowExport.hpp"
+#include <string.h>
+#include <fstream>
+#include <vector>
+
+static const char kArrowMagic[] = "ARROW1";
+static const uint32_t kContinuation = 0xFFFFFFFF;
+static const int16_t kMetadataV5 = 4;
+static const size_t kBufferAlignment = 64;
+
+// Schema.fbs / Message.fbs enums
+enum ArrowTypeId : uint8_t { ArrowInt = 2, ArrowFloatingPoint = 3, ArrowUtf8 = 5, ArrowBool = 6, ArrowList = 12 };
+enum ArrowMessageHeader : uint8_t { ArrowSchemaHeader = 1, ArrowRecordBatchHeader = 3 };
+
+// Builds one FlatBuffer. Objects are collected first and written depth first
+// with every child after its parent, so all offsets point forward the way the
+// format wants, tables start on 8 bytes and their vtables sit right before them.
+class FlatBuilder
+{
+private:
+  enum Kind { TableObject, StringObject, VectorObject, StructVectorObject };
+  struct Slot
+  {
+    // 0 when the field is absent, offsets are 4
+    uint8_t size = 0;
+    uint64_t value = 0;
+    int child = -1;
+  };
+  struct Object
+  {
+    Kind kind;
+    vector<Slot> slots;
+    string bytes;
+    uint32_t count = 0;
+    vector<int> children;
+  };
+  vector<Object> _objects;
+  string _out;
+
+  void _align(size_t alignment) {
+    _out.resize((_out.size() + alignment - 1) / alignment * alignment, '\0');
+  }
+  template <typename T> void _put(T value) {
+    _out.append((const char *)&value, sizeof(value));
+  }
+  void _patchOffset(size_t at, uint32_t target) {
+    uint32_t offset = target - (uint32_t)at;
+    memcpy(&_out[at], &offset, sizeof(offset));
+  }
+  Slot &_slot(int table, int field) {
+    vector<Slot> &slots = _objects[table].slots;
+    if (slots.size() <= (size_t)field) {
+      slots.resize(field + 1);
+    }
+    return slots[field];
+  }
+  int _add(Object object) {
+    _objects.push_back(move(object));
+    return (int)_objects.size() - 1;
+  }
+  uint32_t _writeTable(int index);
+  uint32_t _write(int index);
+public:
+  int table() { return _add({TableObject, {}, string(), 0, {}}); }
+  template <typename T> void scalar(int table, int field, T value) {
+    Slot &slot = _slot(table, field);
+    slot.size = sizeof(T);
+    memcpy(&slot.value, &value, sizeof(T));
+  }
+  void offset(int table, int field, int child) {
+    Slot &slot = _slot(table, field);
+    slot.size = 4;
+    slot.child = child;
+  }
+  int text(const string &value) {
+    return _add({StringObject, {}, value, 0, {}});
+  }
+  int vectorOf(const vector<int> &children) {
+    return _add({VectorObject, {}, string(), 0, children});
+  }
+  // packed structs of 8 byte alignment, FieldNode, Buffer and Block
+  int structs(const string &bytes, uint32_t count) {
+    return _add({StructVectorObject, {}, bytes, count, {}});
+  }
+  string finish(int root);
+};
+
+uint32_t FlatBuilder::_writeTable(int index)
+{
+  const vector<Slot> &slots = _objects[index].slots;
+  // the soffset to the vtable first, then the fields from the widest down so none needs padding
+  vector<uint16_t> fieldOffsets(slots.size(), 0);
+  uint32_t tableSize = 4;
+  for (uint8_t size : {8, 4, 2, 1}) {
+    for (size_t i = 0; i < slots.size(); ++i) {
+      if (slots[i].size == size) {
+        tableSize = (tableSize + size - 1) / size * size;
+        fieldOffsets[i] = tableSize;
+        tableSize += size;
+      }
+    }
+  }
+  _align(2);
+  size_t vtable = _out.size();
+  _put<uint16_t>(4 + 2 * slots.size());
+  _put<uint16_t>(tableSize);
+  for (uint16_t fieldOffset : fieldOffsets) {
+    _put<uint16_t>(fieldOffset);
+  }
+  _align(8);
+  size_t table = _out.size();
+  _put<int32_t>((int32_t)(table - vtable));
+  _out.resize(table + tableSize, '\0');
+  for (size_t i = 0; i < slots.size(); ++i) {
+    if (slots[i].size > 0 && slots[i].child < 0) {
+      memcpy(&_out[table + fieldOffsets[i]], &slots[i].value, slots[i].size);
+    }
+  }
+  for (size_t i = 0; i < slots.size(); ++i) {
+    if (slots[i].child >= 0) {
+      _patchOffset(table + fieldOffsets[i], _write(slots[i].child));
+    }
+  }
+  return (uint32_t)table;
+}
+
+uint32_t FlatBuilder::_write(int index)
+{
+  const Object &object = _objects[index];
+  size_t position;
+  switch (object.kind) {
+    case TableObject:
+      return _writeTable(index);
+    case StringObject:
+      _align(4);
+      position = _out.size();
+      _put<uint32_t>((uint32_t)object.bytes.size());
+      _out += object.bytes;
+      _out += '\0';
+      return (uint32_t)position;
+    case VectorObject:
+      _align(4);
+      position = _out.size();
+      _put<uint32_t>((uint32_t)object.children.size());
+      _out.resize(_out.size() + 4 * object.children.size(), '\0');
+      for (size_t i = 0; i < object.children.size(); ++i) {
+        _patchOffset(position + 4 + 4 * i, _write(object.children[i]));
+      }
+      return (uint32_t)position;
+    case StructVectorObject:
+      // the elements after the length have to be 8 byte aligned
+      while ((_out.size() + 4) % 8 != 0) {
+        _out += '\0';
+      }
+      position = _out.size();
+      _put<uint32_t>(object.count);
+      _out += object.bytes;
+      return (uint32_t)position;
+  }
+  return 0;
+}
+
+string FlatBuilder::finish(int root)
+{
+  _out.clear();
+  _put<uint32_t>(0);
+  _patchOffset(0, _write(root));
+  _align(8);
+  return _out;
+}
+
+template <typename T>
+static void _append(string &bytes, T value)
+{
+  bytes.append((const char *)&value, sizeof(value));
+}
+
+// the buffers and field nodes of one record batch, in schema order
+struct ArrowBody
+{
+  string data;
+  string buffers;
+  uint32_t bufferCount = 0;
+  string nodes;
+  uint32_t nodeCount = 0;
+
+  void addNode(size_t length) {
+    _append<int64_t>(nodes, length);
+    _append<int64_t>(nodes, 0);
+    nodeCount++;
+  }
+  // a buffer appended to data directly starts at beginBuffer and ends with endBuffer
+  size_t beginBuffer() const { return data.size(); }
+  void endBuffer(size_t start) {
+    _append<int64_t>(buffers, start);
+    _append<int64_t>(buffers, data.size() - start);
+    bufferCount++;
+    data.resize((data.size() + kBufferAlignment - 1) / kBufferAlignment * kBufferAlignment, '\0');
+  }
+  void addBuffer(const void *bytes, size_t length) {
+    size_t start = beginBuffer();
+    if (length > 0) {
+      data.append((const char *)bytes, length);
+    }
+    endBuffer(start);
+  }
+  // every column is non nullable, an empty validity buffer says so
+  void addValidity() { addBuffer(nullptr, 0); }
+};
+
+static bool _isBool(const DataColumn &column)
+{
+  return column.type() == "BOOL" || column.type() == "bool";
+}
+
+static int _addType(FlatBuilder &builder, ColumnEncoding encoding, bool isBool, uint8_t &typeId)
+{
+  int type = builder.table();
+  if (isBool) {
+    typeId = ArrowBool;
+  } else if (encoding == Int32Encoding || encoding == Int64Encoding) {
+    typeId = ArrowInt;
+    builder.scalar<int32_t>(type, 0, encoding == Int32Encoding ? 32 : 64);
+    builder.scalar<uint8_t>(type, 1, 1);
+  } else if (encoding == DoubleEncoding) {
+    typeId = ArrowFloatingPoint;
+    builder.scalar<int16_t>(type, 0, 2);
+  } else {
+    typeId = ArrowUtf8;
+  }
+  return type;
+}
+
+static int _addField(FlatBuilder &builder, const string &name, int type, uint8_t typeId, const vector<int> &children)
+{
+  int field = builder.table();
+  builder.offset(field, 0, builder.text(name));
+  builder.scalar<uint8_t>(field, 1, 0);
+  builder.scalar<uint8_t>(field, 2, typeId);
+  builder.offset(field, 3, type);
+  builder.offset(field, 5, builder.vectorOf(children));
+  return field;
+}
+
+static int _addSchema(FlatBuilder &builder, const DataTable &table)
+{
+  static const ColumnEncoding listElements[] = {StringEncoding, Int32Encoding, Int64Encoding, DoubleEncoding};
+  vector<int> fields;
+  for (const DataColumn &column : table.columns()) {
+    uint8_t typeId;
+    if (column.isList()) {
+      ColumnEncoding elementEncoding = listElements[column.encoding() - StringListEncoding];
+      int elementType = _addType(builder, elementEncoding, false, typeId);
+      int item = _addField(builder, "item", elementType, typeId, vector<int>());
+      fields.push_back(_addField(builder, column.name(), builder.table(), ArrowList, vector<int>({item})));
+    } else {
+      int type = _addType(builder, column.encoding(), _isBool(column), typeId);
+      fields.push_back(_addField(builder, column.name(), type, typeId, vector<int>()));
+    }
+  }
+  const DataTableSchema &tableSchema = table.schema();
+  vector<pair<string, string>> metadata({{"csvreader.kind", tableSchema.isMatrix() ? "matrix" :
+    tableSchema.kind == SchemaGroupTable ? "group" : "table"}});
+  if (!tableSchema.key.empty()) {
+    metadata.push_back(make_pair("csvreader.key", tableSchema.key));
+  }
+  vector<int> keyValues;
+  for (auto &entry : metadata) {
+    int keyValue = builder.table();
+    builder.offset(keyValue, 0, builder.text(entry.first));
+    builder.offset(keyValue, 1, builder.text(entry.second));
+    keyValues.push_back(keyValue);
+  }
+  int schema = builder.table();
+  builder.scalar<int16_t>(schema, 0, 0);
+  builder.offset(schema, 1, builder.vectorOf(fields));
+  builder.offset(schema, 2, builder.vectorOf(keyValues));
+  return schema;
+}
+
+static void _addStrings(ArrowBody &body, const vector<StringRef> &strings)
+{
+  vector<int32_t> offsets(1, 0);
+  offsets.reserve(strings.size() + 1);
+  for (const StringRef &value : strings) {
+    offsets.push_back(offsets.back() + (int32_t)value.size);
+  }
+  body.addValidity();
+  body.addBuffer(offsets.data(), offsets.size() * sizeof(int32_t));
+  size_t start = body.beginBuffer();
+  body.data.reserve(start + offsets.back() + kBufferAlignment);
+  for (const StringRef &value : strings) {
+    body.data.append(value.data, value.size);
+  }
+  body.endBuffer(start);
+}
+
+// values of an int, long, double or string column or of all items of a list column
+static void _addValues(ArrowBody &body, const DataColumn &column, ColumnEncoding encoding, size_t count)
+{
+  body.addNode(count);
+  if (encoding == StringEncoding) {
+    _addStrings(body, column.stringValues());
+    return;
+  }
+  body.addValidity();
+  if (_isBool(column)) {
+    string bits((count + 7) / 8, '\0');
+    for (size_t row = 0; row < count; ++row) {
+      bits[row / 8] |= (column.int32At(row) != 0) << (row % 8);
+    }
+    body.addBuffer(bits.data(), bits.size());
+  } else if (encoding == Int32Encoding) {
+    body.addBuffer(column.int32Values().data(), count * sizeof(int32_t));
+  } else if (encoding == Int64Encoding) {
+    body.addBuffer(column.int64Values().data(), count * sizeof(int64_t));
+  } else {
+    body.addBuffer(column.doubleValues().data(), count * sizeof(double));
+  }
+}
+
+static void _addColumn(ArrowBody &body, const DataColumn &column, size_t rowCount)
+{
+  static const ColumnEncoding listElements[] = {StringEncoding, Int32Encoding, Int64Encoding, DoubleEncoding};
+  if (!column.isList()) {
+    _addValues(body, column, column.encoding(), rowCount);
+    return;
+  }
+  vector<int32_t> offsets(1, 0);
+  offsets.reserve(rowCount + 1);
+  for (size_t row = 0; row < rowCount; ++row) {
+    offsets.push_back(offsets.back() + (int32_t)column.listSize(row));
+  }
+  body.addNode(rowCount);
+  body.addValidity();
+  body.addBuffer(offsets.data(), offsets.size() * sizeof(int32_t));
+  _addValues(body, column, listElements[column.encoding() - StringListEncoding], offsets.back());
+}
+
+// continuation marker, metadata length, the metadata padded so the body
+// starts on kBufferAlignment of the file, then the body. Returns the padded
+// metadata length including the 8 byte prefix.
+static int32_t _appendMessage(string &out, const string &metadata, const string &body)
+{
+  size_t start = out.size();
+  size_t bodyStart = (start + 8 + metadata.size() + kBufferAlignment - 1) / kBufferAlignment * kBufferAlignment;
+  _append<uint32_t>(out, kContinuation);
+  _append<int32_t>(out, (int32_t)(bodyStart - start - 8));
+  out += metadata;
+  out.resize(bodyStart, '\0');
+  out += body;
+  return (int32_t)(bodyStart - start);
+}
+
+static string _message(uint8_t headerType, int64_t bodyLength, FlatBuilder &builder, int header)
+{
+  int message = builder.table();
+  builder.scalar<int16_t>(message, 0, kMetadataV5);
+  builder.scalar<uint8_t>(message, 1, headerType);
+  builder.offset(message, 2, header);
+  builder.scalar<int64_t>(message, 3, bodyLength);
+  return builder.finish(message);
+}
+
+string encodeArrowTable(const DataTable &table, ArrowFormat format)
+{
+  string out;
+  if (format == ArrowFileFormat) {
+    out.append(kArrowMagic, 6);
+    out.append(2, '\0');
+  }
+  FlatBuilder schemaBuilder;
+  _appendMessage(out, _message(ArrowSchemaHeader, 0, schemaBuilder, _addSchema(schemaBuilder, table)), string());
+
+  ArrowBody body;
+  for (const DataColumn &column : table.columns()) {
+    _addColumn(body, column, table.rowCount());
+  }
+  FlatBuilder batchBuilder;
+  int batch = batchBuilder.table();
+  batchBuilder.scalar<int64_t>(batch, 0, table.rowCount());
+  batchBuilder.offset(batch, 1, batchBuilder.structs(body.nodes, body.nodeCount));
+  batchBuilder.offset(batch, 2, batchBuilder.structs(body.buffers, body.bufferCount));
+  string metadata = _message(ArrowRecordBatchHeader, body.data.size(), batchBuilder, batch);
+  int64_t batchOffset = out.size();
+  int32_t metadataLength = _appendMessage(out, metadata, body.data);
+
+  // end of stream
+  _append<uint32_t>(out, kContinuation);
+  _append<int32_t>(out, 0);
+  if (format == ArrowStreamFormat) {
+    return out;
+  }
+  // Block: offset, metadata length with its 8 byte prefix, padding, body length
+  string block;
+  _append<int64_t>(block, batchOffset);
+  _append<int32_t>(block, metadataLength);
+  _append<int32_t>(block, 0);
+  _append<int64_t>(block, body.data.size());
+  FlatBuilder footerBuilder;
+  int footer = footerBuilder.table();
+  footerBuilder.scalar<int16_t>(footer, 0, kMetadataV5);
+  footerBuilder.offset(footer, 1, _addSchema(footerBuilder, table));
+  footerBuilder.offset(footer, 2, footerBuilder.structs(string(), 0));
+  footerBuilder.offset(footer, 3, footerBuilder.structs(block, 1));
+  string footerBytes = footerBuilder.finish(footer);
+  out += footerBytes;
+  _append<int32_t>(out, (int32_t)footerBytes.size());
+  out.append(kArrowMagic, 6);
+  return out;
+}
+
+bool writeArrowTable(const DataTable &table, const string &path, ArrowFormat format, string &error)
+{
+  string content = encodeArrowTable(table, format);
+  ofstream outfile(path, ofstream::binary);
+  outfile.write(content.data(), content.size());
+  if (!outfile) {
+    error = "can't write " + path;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,38 @@
+//
+//  ArrowExport.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef ArrowExport_hpp
+#define ArrowExport_hpp
+
+#include <stdio.h>
+#include <string>
+#include "GameDataReader.hpp"
+
+using namespace std;
+
+// Arrow IPC (columnar format 1.0, metadata V5) written without the Arrow
+// library: the FlatBuffers metadata is laid out by hand. A table becomes one
+// record batch, columns keep the types of the type row:
+//   int -> int32, long/NSInteger -> int64, double -> float64, BOOL -> bool,
+//   string/id/stringId/groupId/name_ -> utf8, set/array -> list<utf8>,
+//   set<int>/array<long>/... -> list<int32/int64/float64>,
+//   matrix -> one utf8 column for the row keys and one per matrix column.
+// Nothing is nullable, every buffer starts on a 64 byte boundary of the file
+// so readers can map the columns without copying.
+enum ArrowFormat
+{
+  // "ARROW1" with a footer, for random access and memory mapping
+  ArrowFileFormat,
+  // the bare message stream, for pipes
+  ArrowStreamFormat,
+};
+
+string encodeArrowTable(const DataTable &table, ArrowFormat format);
+bool writeArrowTable(const DataTable &table, const string &path, ArrowFormat format, string &error);
+
+#endif /* ArrowExport_hpp */
@@ -0,0 +1,216 @@
+//
+//  Benchmark.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "Benchmark.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include "DataBuilder.hpp"
+#include "DataGenerator.hpp"
+#include "ObjectiveFile.hpp"
+#include "ReadCSVFile.hpp"
+
+using namespace std;
+
+struct BenchmarkCase
+{
+  string name;
+  size_t bytes;
+  size_t rows;
+  function<void()> run;
+};
+
+// keeps the optimizer from dropping work whose result is otherwise unused
+static volatile size_t _benchmarkSink;
+
+static vector<string> _readLines(const string &path)
+{
+  ifstream indata(path);
+  vector<string> lines;
+  string line;
+  while (getline(indata, line, '\r')) {
+    line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+static size_t _fileSize(const string &path)
+{
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+static void _report(const BenchmarkCase &benchmark, double seconds)
+{
+  double mbPerSecond = benchmark.bytes / seconds / (1024.0 * 1024.0);
+  printf("%-28s %10.3f ms %10.1f MB/s", benchmark.name.c_str(), seconds * 1000.0, mbPerSecond);
+  if (benchmark.rows > 0) {
+    printf(" %12.0f rows/s", benchmark.rows / seconds);
+  }
+  printf("\n");
+}
+
+static double _measure(const BenchmarkCase &benchmark, int iterations)
+{
+  double best = 0;
+  streambuf *output = cout.rdbuf(nullptr);
+  for (int i = 0; i < iterations; ++i) {
+    auto start = chrono::steady_clock::now();
+    benchmark.run();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (i == 0 || seconds < best) {
+      best = seconds;
+    }
+  }
+  cout.rdbuf(output);
+  cout.clear();
+  return best;
+}
+
+void runBenchmarks(const string &workPath, int scale, int iterations)
+{
+  DataSetSpec spec;
+  spec.scale = scale;
+  DataSetStats stats = generateDataSet(workPath, spec);
+  cout << "data set: " << stats.files << " files, " << stats.bytes << " bytes, " << stats.rows << " rows in " << workPath << endl;
+  
+  string excelPath = workPath + "DataSource/excel/";
+  string classPath = workPath + "FileTestProject/Classes/DataProcessing/";
+  vector<string> lines = _readLines(excelPath + "goods.csv");
+  size_t lineBytes = 0;
+  for (const string &line : lines) {
+    lineBytes += line.size() + 1;
+  }
+  size_t dataRows = lines.size() - 2;
+  
+  // typed cells of the wide table, in the order the converter encodes them
+  ObjectiveArena arena;
+  static const map<string, ObjectiveType *> cellTypes({
+    {"int", arena.type("int")},
+    {"long", arena.type("long")},
+    {"NSInteger", arena.type("NSInteger")},
+    {"double", arena.type("double")},
+    {"string", arena.type("NSString", true)},
+    {"set", arena.type("NSSet", true)},
+    {"array", arena.type("NSArray", true)},
+  });
+  vector<string> types;
+  splitCells(lines[1], CSV_SEPARATOR_CHARS, types);
+  vector<pair<ObjectiveType *, string>> cells;
+  size_t cellBytes = 0;
+  vector<string> tokens;
+  for (size_t row = 2; row < lines.size(); ++row) {
+    splitCells(lines[row], CSV_SEPARATOR_CHARS, tokens);
+    for (size_t col = 0; col < tokens.size() && col < types.size(); ++col) {
+      if (cellTypes.count(types[col])) {
+        cells.push_back(make_pair(cellTypes.at(types[col]), tokens[col]));
+        cellBytes += tokens[col].size();
+      }
+    }
+  }
+  
+  const size_t valueCount = 100000 * scale;
+  const string sampleString = "saffron_trade_route";
+  bb::ByteBuffer sampleBuffer;
+  for (size_t i = 0; i < valueCount; ++i) {
+    sampleBuffer.putInt((uint32_t)i);
+    sampleBuffer.putLong(i * 31);
+    sampleBuffer.putDouble(i * 0.5);
+    sampleBuffer.putString(sampleString);
+  }
+  
+  LocalizedStringTable localizedMap;
+  auto goodsBuffer = std::make_unique<bb::ByteBuffer>();
+  Validator validator("goods.csv");
+  streambuf *output = cout.rdbuf(nullptr);
+  ObjectiveFile *goodsFile = convertCSVToObjectiveClass(arena, excelPath, "goods.csv", localizedMap, goodsBuffer, validator, ConvertOptions());
+  cout.rdbuf(output);
+  cout.clear();
+  ObjectiveFile *managerFile = arena.make<ObjectiveFile>("BenchmarkManager");
+  ObjectiveClass *managerClass = arena.make<ObjectiveClass>("BenchmarkManager");
+  managerFile->addClass(managerClass);
+  for (int i = 0; i < 1000; ++i) {
+    string dic = "Table" + to_string(i) + "Dic";
+    managerClass->addImpProperty(arena.make<ObjectiveProperty>("_table" + to_string(i) + "Dic", arena.type(dic, true)));
+    ObjectiveFunction *getter = arena.make<ObjectiveFunction>("-(" + dic + " *)get" + dic);
+    getter->addLines("return _table" + to_string(i) + "Dic;");
+    managerClass->addFunction(getter);
+  }
+  goodsFile->writeToFile(classPath);
+  managerFile->writeToFile(classPath);
+  size_t goodsFileBytes = _fileSize(classPath + "GoodsData.h") + _fileSize(classPath + "GoodsData.m");
+  size_t managerFileBytes = _fileSize(classPath + "BenchmarkManager.h") + _fileSize(classPath + "BenchmarkManager.m");
+  
+  BuildOptions buildOptions;
+  buildOptions.rootPath = workPath;
+  
+  vector<BenchmarkCase> benchmarks;
+  benchmarks.push_back({"tokenize rows", lineBytes, dataRows, [&]() {
+    size_t count = 0;
+    vector<string> cells;
+    for (const string &line : lines) {
+      splitCells(line, CSV_SEPARATOR_CHARS, cells);
+      count += cells.size();
+    }
+    _benchmarkSink = count;
+  }});
+  benchmarks.push_back({"tokenize rows regex", lineBytes, dataRows, [&]() {
+    size_t count = 0;
+    for (const string &line : lines) {
+      count += splitStr(line, CSV_SEPARATOR).size();
+    }
+    _benchmarkSink = count;
+  }});
+  benchmarks.push_back({"_saveBuffer cells", cellBytes, dataRows, [&]() {
+    auto buffer = std::make_unique<bb::ByteBuffer>();
+    for (const pair<ObjectiveType *, string> &cell : cells) {
+      _saveBuffer(buffer, cell.first, cell.second);
+    }
+    _benchmarkSink = buffer->size();
+  }});
+  benchmarks.push_back({"ByteBuffer put", sampleBuffer.size(), 0, [&]() {
+    bb::ByteBuffer buffer;
+    for (size_t i = 0; i < valueCount; ++i) {
+      buffer.putInt((uint32_t)i);
+      buffer.putLong(i * 31);
+      buffer.putDouble(i * 0.5);
+      buffer.putString(sampleString);
+    }
+    _benchmarkSink = buffer.size();
+  }});
+  benchmarks.push_back({"ByteBuffer get", sampleBuffer.size(), 0, [&]() {
+    sampleBuffer.setReadPos(0);
+    size_t total = 0;
+    for (size_t i = 0; i < valueCount; ++i) {
+      total += sampleBuffer.getInt();
+      total += sampleBuffer.getLong();
+      total += (size_t)sampleBuffer.getDouble();
+      total += sampleBuffer.getString().size();
+    }
+    _benchmarkSink = total;
+  }});
+  benchmarks.push_back({"generate table class", goodsFileBytes, 0, [&]() {
+    goodsFile->writeToFile(classPath);
+  }});
+  benchmarks.push_back({"generate 1000 getters", managerFileBytes, 0, [&]() {
+    managerFile->writeToFile(classPath);
+  }});
+  benchmarks.push_back({"end to end build", stats.bytes, stats.rows, [&]() {
+    DataBuilder builder(buildOptions);
+    builder.build();
+  }});
+  
+  for (const BenchmarkCase &benchmark : benchmarks) {
+    _report(benchmark, _measure(benchmark, iterations));
+  }
+}
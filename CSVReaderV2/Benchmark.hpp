@@ -0,0 +1,22 @@
+//
+//  Benchmark.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include <stdio.h>
+#include <string>
+
+using namespace std;
+
+// Generates a synthetic data set under workPath and times the tokenizer,
+// cell encoding, ByteBuffer, code generation and a full build on it. Each
+// case reports its best run out of iterations as MB/s and rows/s.
+void runBenchmarks(const string &workPath, int scale, int iterations);
+
+#endif /* Benchmark_hpp */
@@ -0,0 +1,134 @@
+//
+//  BuildOptions.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "BuildOptions.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+
+static void _printUsage(const char *program)
+{
+  cerr << "usage: " << program << " [--root <path>] [--watch] [--poll-ms <ms>] [--trace <file>] [--alloc-stats]" << endl;
+  cerr << "       " << string(strlen(program), ' ') << " [--embed-strings] [--columnar] [--pack-numbers] [--column-descriptors] [--table-index]" << endl;
+  cerr << "       " << string(strlen(program), ' ') << " [--shards <file>] [--shard-kb <kb>] [--access-trace <file>] [--arrow <dir>] [--arrow-stream]" << endl;
+  cerr << "       " << string(strlen(program), ' ') << " [--memory-mb <mb>] [--spill-dir <dir>]" << endl;
+  cerr << "       " << program << " --generate <path> [--scale <n>]" << endl;
+  cerr << "       " << program << " --bench <path> [--scale <n>] [--iterations <n>]" << endl;
+  cerr << "       " << program << " --verify <game.dat>" << endl;
+  cerr << "       " << program << " --describe <game.dat>" << endl;
+  cerr << "       " << program << " --query <game.dat or root> \"select ... from <table> [where ...] [group by ...] [limit n]\"" << endl;
+  cerr << "       " << program << " --make-patch <old game.dat> <new game.dat> <patch>" << endl;
+  cerr << "       " << program << " --apply-patch <old game.dat> <patch> <new game.dat>" << endl;
+  cerr << "  --root <path>   project root containing DataSource/ and FileTestProject/" << endl;
+  cerr << "  --watch         stay resident and rebuild the changed sources on save" << endl;
+  cerr << "  --poll-ms <ms>  rescan interval when no native file notification is available" << endl;
+  cerr << "  --trace <file>  write a Chrome trace-event timeline of the build phases" << endl;
+  cerr << "  --alloc-stats   report heap allocations, bytes and peak rss per phase and file" << endl;
+  cerr << "  --embed-strings write the text of name_ columns into game.dat, indexed by row" << endl;
+  cerr << "  --columnar      store tables column by column and generate lazily materialized rows" << endl;
+  cerr << "  --pack-numbers  columnar, with integer columns packed into as few bits as their values need" << endl;
+  cerr << "  --column-descriptors  decode rows through a column table per class and one shared" << endl;
+  cerr << "                  DataDecoder instead of generating the reads of every column" << endl;
+  cerr << "  --table-index   append the offset, size and CRC-32C of every table to game.dat" << endl;
+  cerr << "                  and generate a DataManager that rejects damaged data" << endl;
+  cerr << "  --shards <file> write one .dat per shard listed as 'shard: table table ...' and a manifest" << endl;
+  cerr << "  --shard-kb <kb> pack the tables no shard lists into shards of at most kb" << endl;
+  cerr << "  --access-trace <file> lay out game.dat and shards with the tables of a startup trace first," << endl;
+  cerr << "                  the DataManager writes one to tmp/data_access.trace when built with DATA_ACCESS_TRACE" << endl;
+  cerr << "  --arrow <dir>   also export every table to <dir>/<table>.arrow (Arrow IPC file format)" << endl;
+  cerr << "  --arrow-stream  export .arrows in the Arrow IPC stream format instead" << endl;
+  cerr << "  --memory-mb <mb> keep at most about mb of converted data in memory, the rest is spilled" << endl;
+  cerr << "                  to temporary files and merged into the output, which stays the same" << endl;
+  cerr << "  --spill-dir <dir> where the temporary files go, $TMPDIR or /tmp by default" << endl;
+  cerr << "  --verify        check every table of a game.dat or shard against its checksum" << endl;
+  cerr << "  --describe      decode a game.dat built with --table-index and list its tables and columns" << endl;
+  cerr << "  --query         filter, project or aggregate one table of a game.dat built with --table-index," << endl;
+  cerr << "                  or of the sources under a project root, and print the result as CSV" << endl;
+  cerr << "  --make-patch    write a binary patch from one game.dat to another" << endl;
+  cerr << "  --apply-patch   rebuild the new game.dat from the old one and a patch" << endl;
+  cerr << "  --generate <path>  write a deterministic synthetic project under path" << endl;
+  cerr << "  --bench <path>  generate a data set under path and time every stage on it" << endl;
+}
+
+static void _appendSlash(string &path)
+{
+  if (path.size() > 0 && path.back() != '/') {
+    path += "/";
+  }
+}
+
+bool parseBuildOptions(int argc, const char * argv[], BuildOptions &options)
+{
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--root" && hasValue) {
+      options.rootPath = argv[++i];
+      _appendSlash(options.rootPath);
+    } else if (arg == "--watch") {
+      options.watch = true;
+    } else if (arg == "--poll-ms" && hasValue) {
+      options.pollIntervalMs = atoi(argv[++i]);
+    } else if (arg == "--trace" && hasValue) {
+      options.tracePath = argv[++i];
+    } else if (arg == "--alloc-stats") {
+      options.allocationStats = true;
+    } else if (arg == "--embed-strings") {
+      options.convert.embedStrings = true;
+    } else if (arg == "--columnar") {
+      options.convert.columnar = true;
+    } else if (arg == "--pack-numbers") {
+      options.convert.columnar = true;
+      options.convert.packNumbers = true;
+    } else if (arg == "--column-descriptors") {
+      options.convert.columnDescriptors = true;
+    } else if (arg == "--table-index") {
+      options.tableIndex = true;
+    } else if (arg == "--verify" && hasValue) {
+      options.verifyPath = argv[++i];
+    } else if (arg == "--describe" && hasValue) {
+      options.describePath = argv[++i];
+    } else if (arg == "--query" && i + 2 < argc) {
+      options.queryPath = argv[++i];
+      options.queryText = argv[++i];
+    } else if (arg == "--arrow" && hasValue) {
+      options.arrowPath = argv[++i];
+      _appendSlash(options.arrowPath);
+    } else if (arg == "--arrow-stream") {
+      options.arrowStream = true;
+    } else if (arg == "--shards" && hasValue) {
+      options.shardMapPath = argv[++i];
+    } else if (arg == "--shard-kb" && hasValue) {
+      options.shardBudget = max(0, atoi(argv[++i])) * (size_t)1024;
+    } else if (arg == "--access-trace" && hasValue) {
+      options.accessTracePath = argv[++i];
+    } else if (arg == "--memory-mb" && hasValue) {
+      options.memoryBudget = max(0, atoi(argv[++i])) * (size_t)1024 * 1024;
+    } else if (arg == "--spill-dir" && hasValue) {
+      options.spillPath = argv[++i];
+    } else if ((arg == "--make-patch" || arg == "--apply-patch") && i + 3 < argc) {
+      options.patchCommand = arg;
+      options.patchPaths.assign(argv + i + 1, argv + i + 4);
+      i += 3;
+    } else if (arg == "--generate" && hasValue) {
+      options.generatePath = argv[++i];
+      _appendSlash(options.generatePath);
+    } else if (arg == "--bench" && hasValue) {
+      options.benchmarkPath = argv[++i];
+      _appendSlash(options.benchmarkPath);
+    } else if (arg == "--scale" && hasValue) {
+      options.scale = max(1, atoi(argv[++i]));
+    } else if (arg == "--iterations" && hasValue) {
+      options.iterations = max(1, atoi(argv[++i]));
+    } else {
+      _printUsage(argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,87 @@
+//
+//  BuildOptions.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef BuildOptions_hpp
+#define BuildOptions_hpp
+
+#include <stdio.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+// Switches that change what the converters generate, every one of them
+// defaults to the classic game.dat layout and classes.
+struct ConvertOptions
+{
+  // store name_ columns in game.dat so getters don't go through NSLocalizedString
+  bool embedStrings = false;
+  // column major tables, rows and their NSStrings are created on first access
+  bool columnar = false;
+  // columnar int, BOOL and long columns bit-packed, delta or run length encoded, whichever is smallest
+  bool packNumbers = false;
+  // row classes describe their columns in a static array that one shared DataDecoder reads,
+  // instead of a read line per column (the columnar layout has its own loops)
+  bool columnDescriptors = false;
+  // tables a ref<> column points at, filled in by the builder before it converts anything
+  unordered_set<string> referencedTables;
+};
+
+struct BuildOptions
+{
+  string rootPath = "/Users/yujiel/Dropbox (Personal)/Code/gitCode/SalingGame/";
+  // keep running and rebuild whenever a source file changes
+  bool watch = false;
+  int pollIntervalMs = 200;
+  // Chrome trace-event timeline of every build, empty to skip
+  string tracePath;
+  // count heap allocations per phase and per file
+  bool allocationStats = false;
+  ConvertOptions convert;
+  // append the table index to game.dat, patches can then align tables by name
+  bool tableIndex = false;
+  // also write every converted table as <table>.arrow into this directory
+  string arrowPath;
+  // Arrow stream format (<table>.arrows) instead of the file format
+  bool arrowStream = false;
+  // split game.dat into shards by a "shard: table ..." file and/or a size budget in bytes
+  string shardMapPath;
+  size_t shardBudget = 0;
+  // tables first used at startup, recorded by a game built with DATA_ACCESS_TRACE, go first in game.dat
+  string accessTracePath;
+  // converted tables and strings beyond this many bytes go to temporary files under spillPath, 0 for no limit
+  size_t memoryBudget = 0;
+  string spillPath;
+  // write a synthetic data set or run the benchmarks instead of building
+  string generatePath;
+  string benchmarkPath;
+  int scale = 1;
+  int iterations = 5;
+  // check the table checksums of this file instead of building
+  string verifyPath;
+  // decode this file with the schema in its index and list what is in it
+  string describePath;
+  // --query <game.dat or project root> <query>
+  string queryPath;
+  string queryText;
+  // --make-patch <old> <new> <patch> or --apply-patch <old> <patch> <new>
+  string patchCommand;
+  vector<string> patchPaths;
+  
+  string resourcePath() const { return rootPath + "FileTestProject/Resources/"; }
+  string classPath() const { return rootPath + "FileTestProject/Classes/DataProcessing/"; }
+  string excelPath() const { return rootPath + "DataSource/excel/"; }
+  string matrixPath() const { return rootPath + "DataSource/Matrix/"; }
+  string stringPath() const { return rootPath + "DataSource/string/"; }
+};
+
+// returns false and prints the usage if the arguments can't be parsed
+bool parseBuildOptions(int argc, const char * argv[], BuildOptions &options);
+
+#endif /* BuildOptions_hpp */
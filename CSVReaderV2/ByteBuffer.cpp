@@ -15,6 +15,7 @@
  */
 
 #include "ByteBuffer.hpp"
+#include <atomic>
 
 #ifdef BB_USE_NS
 namespace bb {
@@ -142,6 +143,38 @@ namespace bb {
         return buf.size();
     }
     
+    static std::atomic<uint64_t> _growthCount(0);
+    static std::atomic<uint64_t> _growthBytes(0);
+    
+    /**
+     * Growth statistics
+     * The internal vector doubles when it runs out of room, count how often that happens across all buffers
+     *
+     * @return Number of reallocations, and the capacity in bytes they asked for
+     */
+    uint64_t ByteBuffer::growthCount() {
+        return _growthCount;
+    }
+    
+    uint64_t ByteBuffer::growthBytes() {
+        return _growthBytes;
+    }
+    
+    void ByteBuffer::recordGrowth(uint32_t newCapacity) {
+        _growthCount.fetch_add(1, std::memory_order_relaxed);
+        _growthBytes.fetch_add(newCapacity, std::memory_order_relaxed);
+    }
+    
+    /**
+     * Data
+     * Returns the storage of the internal buffer so it can be written out without copying byte by byte
+     *
+     * @return Pointer to the first byte of the internal buffer
+     */
+    const uint8_t* ByteBuffer::data() const {
+        return buf.data();
+    }
+    
     // Replacement
     
     /**
@@ -239,25 +272,17 @@ namespace bb {
     }
     
     std::string ByteBuffer::getString() const {
-        uint64_t len = read<uint64_t>();
-        char *buf = new char[len];
-        for (uint64_t i = 0; i < len; i++) {
-            buf[i] = read<uint8_t>();
-        }
-        std::string str(buf);
-        delete []buf;
+        std::string str = getString(rpos);
+        rpos += sizeof(uint64_t) + str.length();
         return str;
     }
     
     std::string ByteBuffer::getString(uint32_t index) const {
-        uint64_t len = read<uint64_t>(index++);
-        char *buf = new char[len];
-        for (uint64_t i = 0; i < len; i++) {
-            buf[i] = read<uint8_t>(index++);
-        }
-        std::string str(buf);
-        delete []buf;
-        return str;
+        uint64_t len = read<uint64_t>(index);
+        index += sizeof(uint64_t);
+        if (index + len > buf.size())
+            return "";
+        return std::string((const char*) &buf[index], len);
     }
     
     // Write Functions
@@ -60,6 +60,9 @@ namespace bb {
         bool equals(ByteBuffer* other); // Compare if the contents are equivalent
         void resize(uint32_t newSize);
         uint32_t size(); // Size of internal vector
+        const uint8_t* data() const; // Pointer to the internal vector's storage, valid until the next write
+        static uint64_t growthCount(); // Reallocations of the internal vector across all ByteBuffers
+        static uint64_t growthBytes(); // Bytes requested by those reallocations
         
         // Basic Searching (Linear)
         template<typename T> int32_t find(T key, uint32_t start = 0) {
@@ -176,9 +179,13 @@ namespace bb {
             return 0;
         }
         
+        static void recordGrowth(uint32_t newCapacity);
+        
         template<typename T> void append(T data) {
             uint32_t s = sizeof(data);
             
+            if (buf.capacity() < (wpos + s))
+                recordGrowth(wpos + s);
             if (size() < (wpos + s))
                 buf.resize(wpos + s);
             memcpy(&buf[wpos], (uint8_t*) &data, s);
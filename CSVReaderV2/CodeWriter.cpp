@@ -0,0 +1,49 @@
+//
+//  CodeWriter.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "CodeWriter.hpp"
+#include <algorithm>
+#include <cstring>
+#include "Profiler.hpp"
+
+CodeWriter::CodeWriter(ostream &stream, size_t flushSize) : _stream(stream)
+{
+  _flushSize = flushSize;
+}
+
+CodeWriter::~CodeWriter()
+{
+  flush();
+}
+
+void CodeWriter::reserve(size_t sizeHint)
+{
+  _buffer.reserve(min(sizeHint, _flushSize));
+}
+
+void CodeWriter::write(const char *text, size_t length)
+{
+  if (_buffer.size() + length > _flushSize) {
+    flush();
+    if (length > _flushSize) {
+      ProfileScope writeScope(PhaseWrite);
+      _stream.write(text, length);
+      return;
+    }
+  }
+  _buffer.append(text, length);
+}
+
+void CodeWriter::flush()
+{
+  if (_buffer.size() > 0) {
+    ProfileScope writeScope(PhaseWrite);
+    _stream.write(_buffer.data(), _buffer.size());
+    _buffer.clear();
+  }
+}
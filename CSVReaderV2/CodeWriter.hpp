@@ -0,0 +1,40 @@
+//
+//  CodeWriter.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef CodeWriter_hpp
+#define CodeWriter_hpp
+
+#include <stdio.h>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+// Buffered output sink for generated sources. The generator reserves the
+// expected size up front and appends straight into one buffer, which goes
+// to the stream in large blocks instead of through per function strings.
+class CodeWriter
+{
+private:
+  ostream &_stream;
+  string _buffer;
+  size_t _flushSize;
+public:
+  CodeWriter(ostream &stream, size_t flushSize = 1 << 20);
+  ~CodeWriter();
+  void reserve(size_t sizeHint);
+  void write(const char *text, size_t length);
+  void flush();
+  
+  CodeWriter& operator<<(const string &text) { write(text.data(), text.size()); return *this; }
+  CodeWriter& operator<<(const char *text) { write(text, strlen(text)); return *this; }
+  CodeWriter& operator<<(char c) { write(&c, 1); return *this; }
+};
+
+#endif /* CodeWriter_hpp */
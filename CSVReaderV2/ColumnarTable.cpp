@@ -0,0 +1,130 @@
+//
+//  ColumnarTable.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "ColumnarTable.hpp"
+#include "NumberPacking.hpp"
+#include "ReadCSVFile.hpp"
+
+static int32_t _utf16Length(const string &text)
+{
+  int32_t length = 0;
+  for (unsigned char c : text) {
+    // every lead byte starts one UTF-16 unit, four byte sequences need a surrogate pair
+    if ((c & 0xC0) != 0x80) {
+      length += c >= 0xF0 ? 2 : 1;
+    }
+  }
+  return length;
+}
+
+ColumnarTableWriter::ColumnarTableWriter(const vector<ObjectiveType *> &columnTypes, const vector<string> &elementTypes, const vector<bool> &packedColumns)
+{
+  _itemValues = std::make_unique<bb::ByteBuffer>();
+  for (int i = 0; i < columnTypes.size(); ++i) {
+    Column column;
+    column.type = columnTypes[i];
+    column.elementType = elementTypes[i];
+    column.cells = 0;
+    column.packed = packedColumns[i];
+    if (column.type == nullptr) {
+      column.kind = SkippedColumn;
+    } else if (!column.elementType.empty()) {
+      column.kind = PackedColumn;
+    } else if (isTextType(column.type->type())) {
+      column.kind = TextColumn;
+    } else {
+      column.kind = ValueColumn;
+    }
+    if (column.kind == ValueColumn || column.kind == PackedColumn) {
+      column.values = std::make_unique<bb::ByteBuffer>();
+    }
+    column.offsets.push_back(0);
+    _columns.push_back(move(column));
+  }
+}
+
+bool ColumnarTableWriter::isTextType(const string &type)
+{
+  return type == "NSString" || type == "NSSet" || type == "NSArray";
+}
+
+void ColumnarTableWriter::addCell(int column, const string &token)
+{
+  if (column >= _columns.size() || _columns[column].kind == SkippedColumn) {
+    return;
+  }
+  Column &target = _columns[column];
+  if (target.kind == ValueColumn) {
+    _saveBuffer(target.values, target.type, token);
+  } else if (target.kind == PackedColumn) {
+    splitCells(token, ";", _items);
+    if (_items.size() == 1 && _items[0].empty()) {
+      _items.clear();
+    }
+    // parse everything first so a bad item leaves the column untouched
+    ObjectiveType elementType(target.elementType);
+    _itemValues->clear();
+    for (const string &item : _items) {
+      _saveBuffer(_itemValues, &elementType, item);
+    }
+    target.values->putBytes(const_cast<uint8_t *>(_itemValues->data()), _itemValues->size());
+    target.offsets.push_back(target.offsets.back() + (int32_t)_items.size());
+  } else if (target.type->type() == "NSString") {
+    target.text += token;
+    target.offsets.push_back(target.offsets.back() + _utf16Length(token));
+  } else {
+    // normalized the way the row layout splits it, so componentsSeparatedByString gives the same items
+    splitCells(token, ";", _items);
+    string joined;
+    for (int i = 0; i < _items.size(); ++i) {
+      joined += (i > 0 ? ";" : "") + _items[i];
+    }
+    target.text += joined;
+    target.offsets.push_back(target.offsets.back() + _utf16Length(joined));
+  }
+  target.cells++;
+}
+
+size_t ColumnarTableWriter::valueCount(int column) const
+{
+  const Column &target = _columns[column];
+  return target.kind == PackedColumn ? target.offsets.back() : target.cells;
+}
+
+void ColumnarTableWriter::write(bb::ByteBuffer &buffer, size_t rowCount)
+{
+  _valuePositions.assign(_columns.size(), 0);
+  for (int i = 0; i < _columns.size(); ++i) {
+    Column &column = _columns[i];
+    if (column.kind == SkippedColumn) {
+      continue;
+    }
+    while (column.cells < rowCount) {
+      addCell(i, column.kind == ValueColumn ? "0" : "");
+    }
+    if (column.kind == TextColumn) {
+      buffer.putString(column.text);
+    }
+    if (column.kind != ValueColumn) {
+      for (int32_t offset : column.offsets) {
+        buffer.putInt(offset);
+      }
+    }
+    if (column.kind == ValueColumn && column.packed) {
+      size_t width = column.type->type() == "long" || column.type->type() == "NSInteger" ? 8 : 4;
+      vector<int64_t> values(column.cells);
+      for (size_t row = 0; row < column.cells; ++row) {
+        values[row] = width == 8 ? (int64_t)column.values->getLong((uint32_t)(row * 8)) : (int32_t)column.values->getInt((uint32_t)(row * 4));
+      }
+      packNumbers(values, width, buffer);
+    } else if (column.kind != TextColumn) {
+      _valuePositions[i] = buffer.size();
+      buffer.putBytes(const_cast<uint8_t *>(column.values->data()), column.values->size());
+    }
+  }
+}
@@ -0,0 +1,64 @@
+//
+//  ColumnarTable.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef ColumnarTable_hpp
+#define ColumnarTable_hpp
+
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ByteBuffer.hpp"
+#include "ObjectiveFile.hpp"
+
+using namespace std;
+
+// Column major encoding of a table for ConvertOptions::columnar. Numbers
+// are stored as one run of values per column so the generated Dic can read
+// them into plain C arrays. Text columns (strings, sets and arrays) become a
+// single string holding every cell plus the UTF-16 offset where each cell
+// starts, so NSStrings are only cut out of it when a row is accessed. Typed
+// sets and arrays (array<int>...) keep the element offset of every row and
+// one packed block with the values of all rows. Packed integer columns are
+// written with packNumbers instead of one value after the other.
+class ColumnarTableWriter
+{
+private:
+  enum ColumnKind { SkippedColumn, ValueColumn, TextColumn, PackedColumn };
+  struct Column
+  {
+    ColumnKind kind;
+    ObjectiveType *type;
+    string elementType;
+    size_t cells;
+    bool packed;
+    unique_ptr<bb::ByteBuffer> values;
+    string text;
+    // UTF-16 offsets for text, element offsets for packed columns
+    vector<int32_t> offsets;
+  };
+  vector<string> _items;
+  unique_ptr<bb::ByteBuffer> _itemValues;
+  vector<Column> _columns;
+  vector<uint32_t> _valuePositions;
+public:
+  // columns without a type are not stored, same as in the row layout
+  ColumnarTableWriter(const vector<ObjectiveType *> &columnTypes, const vector<string> &elementTypes, const vector<bool> &packedColumns);
+  // throws like _saveBuffer when a number can't be parsed
+  void addCell(int column, const string &token);
+  // values stored so far, the values of packed columns count one by one
+  size_t valueCount(int column) const;
+  // appends all columns in order, missing cells of short rows are padded
+  void write(bb::ByteBuffer &buffer, size_t rowCount);
+  // where write put the first value of a plain value column or of a typed collection column
+  uint32_t valuePosition(int column) const { return _valuePositions[column]; }
+  
+  static bool isTextType(const string &type);
+};
+
+#endif /* ColumnarTable_hpp */
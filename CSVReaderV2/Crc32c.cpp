@@ -0,0 +1,113 @@
+//
+//  Crc32c.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "Crc32c.hpp"
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM 1
+#endif
+
+static const uint32_t kPolynomial = 0x82F63B78;
+
+struct SlicingTables
+{
+  uint32_t table[8][256];
+  
+  SlicingTables()
+  {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (kPolynomial & (0 - (crc & 1)));
+      }
+      table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (int slice = 1; slice < 8; ++slice) {
+        table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xFF];
+      }
+    }
+  }
+};
+
+static const SlicingTables _tables;
+
+static uint32_t _crc32cSlicing(uint32_t crc, const uint8_t *bytes, size_t length)
+{
+  const uint32_t (*table)[256] = _tables.table;
+  for (; length >= 8; length -= 8, bytes += 8) {
+    uint32_t low, high;
+    memcpy(&low, bytes, 4);
+    memcpy(&high, bytes + 4, 4);
+    low ^= crc;
+    crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+          table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+  }
+  for (; length > 0; --length) {
+    crc = (crc >> 8) ^ table[0][(crc ^ *bytes++) & 0xFF];
+  }
+  return crc;
+}
+
+#if CRC32C_X86
+__attribute__((target("sse4.2")))
+static uint32_t _crc32cHardware(uint32_t crc, const uint8_t *bytes, size_t length)
+{
+  uint64_t crc64 = crc;
+  for (; length >= 8; length -= 8, bytes += 8) {
+    uint64_t value;
+    memcpy(&value, bytes, 8);
+    crc64 = _mm_crc32_u64(crc64, value);
+  }
+  crc = (uint32_t)crc64;
+  for (; length > 0; --length) {
+    crc = _mm_crc32_u8(crc, *bytes++);
+  }
+  return crc;
+}
+
+static bool _hasHardware = __builtin_cpu_supports("sse4.2");
+#elif CRC32C_ARM
+static uint32_t _crc32cHardware(uint32_t crc, const uint8_t *bytes, size_t length)
+{
+  for (; length >= 8; length -= 8, bytes += 8) {
+    uint64_t value;
+    memcpy(&value, bytes, 8);
+    crc = __crc32cd(crc, value);
+  }
+  for (; length > 0; --length) {
+    crc = __crc32cb(crc, *bytes++);
+  }
+  return crc;
+}
+
+static bool _hasHardware = true;
+#else
+static bool _hasHardware = false;
+#endif
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t length)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+#if CRC32C_X86 || CRC32C_ARM
+  if (_hasHardware) {
+    return ~_crc32cHardware(~crc, bytes, length);
+  }
+#endif
+  return ~_crc32cSlicing(~crc, bytes, length);
+}
+
+bool crc32cIsHardware()
+{
+  return _hasHardware;
+}
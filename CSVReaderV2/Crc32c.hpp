@@ -0,0 +1,24 @@
+//
+//  Crc32c.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef Crc32c_hpp
+#define Crc32c_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+
+// CRC-32C (Castagnoli) of length bytes, continuing from crc so a table can
+// be checked in pieces: crc32c(crc32c(0, a, n), b, m) == crc32c(0, ab, n + m).
+// Uses the crc32 instruction of SSE 4.2 or ARMv8 when the CPU has it and
+// slicing-by-8 tables otherwise.
+uint32_t crc32c(uint32_t crc, const void *data, size_t length);
+
+// true when crc32c runs on the crc32 instruction
+bool crc32cIsHardware();
+
+#endif /* Crc32c_hpp */
@@ -0,0 +1,914 @@
+//
+//  DataBuilder.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "DataBuilder.hpp"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <sys/stat.h>
+#include "AccessTrace.hpp"
+#include "ArrowExport.hpp"
+#include "Crc32c.hpp"
+#include "GameDataIndex.hpp"
+#include "GameDataReader.hpp"
+#include "ObjectiveFile.hpp"
+#include "Profiler.hpp"
+#include "ReadTxtFile.hpp"
+#include "ShardPlan.hpp"
+#include "SourceIngest.hpp"
+
+using namespace std;
+
+static const string DataManager = "DataManager";
+// merged strings are written to the spill store in pieces of this size
+static const size_t kSpillChunk = 1 << 20;
+// how far the ingest reads ahead of the converter without --memory-mb
+static const size_t kReadAheadBytes = 64 << 20;
+
+static bool _statFile(const string &path, int64_t &modifiedTime, int64_t &fileSize)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return false;
+  }
+#ifdef __APPLE__
+  modifiedTime = st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+  modifiedTime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+  fileSize = st.st_size;
+  return true;
+}
+
+static void _prepareDataManager(ObjectiveArena &arena, ObjectiveClass *dataManagerClass)
+{
+  ObjectiveFunction *dataManagerWithData = arena.make<ObjectiveFunction>("+(instancetype)dataManagerWithData:(NSData *)data");
+  dataManagerWithData->addLines("if (_sharedDataManager == nil) {");
+  dataManagerWithData->addLines("\t_sharedDataManager = [[DataManager alloc] initWithData:data];");
+  dataManagerWithData->addLines("}");
+  dataManagerWithData->addLines("return _sharedDataManager;");
+  dataManagerClass->addFunction(dataManagerWithData);
+  
+  ObjectiveFunction *sharedDataManager = arena.make<ObjectiveFunction>("+(DataManager *)sharedDataManager");
+  sharedDataManager->addLines("return _sharedDataManager;");
+  dataManagerClass->addFunction(sharedDataManager);
+}
+
+static void _prepareDataManager(ObjectiveArena &arena,
+                                const string &name,
+                                ObjectiveClass *dataManagerClass,
+                                ObjectiveFunction *dataManagerInitFunction,
+                                bool isMatrix,
+                                bool traceAccess,
+                                const string &shard = "")
+{
+  string dicString = isMatrix ? nameChange(name,DataDeclare) : nameChange(name, DataDicDeclare);
+  string dicImpString = isMatrix ? nameChange(name, DataImp) : nameChange(name, DataDicImp);
+  ObjectiveProperty *impProperty = arena.make<ObjectiveProperty>(dicImpString, arena.type(dicString, true));
+  dataManagerClass->addImpProperty(impProperty);
+  // a sharded table is read by the load function of its shard the first time it is asked for
+  string indent = shard.size() > 0 ? "" : "\t";
+  dataManagerInitFunction->addLines(indent + dicImpString + " = [[" + dicString + " alloc] initWithByteBuffer:buffer];");
+  ObjectiveFunction *getDicFunction = arena.make<ObjectiveFunction>("-(" + dicString + " *)get" + dicString);
+  if (traceAccess) {
+    getDicFunction->addLines("#ifdef DATA_ACCESS_TRACE");
+    getDicFunction->addLines("DataManagerTraceAccess(@\"" + name + "\");");
+    getDicFunction->addLines("#endif");
+  }
+  if (shard.size() > 0) {
+    getDicFunction->addLines("if (" + dicImpString + " == nil) {");
+    getDicFunction->addLines("\t[self load" + nameChange(shard, Uppercase) + "Shard];");
+    getDicFunction->addLines("}");
+  }
+  getDicFunction->addLines("return " + dicImpString + ";");
+  dataManagerClass->addFunction(getDicFunction);
+}
+
+static void _prepareShardedDataManager(ObjectiveArena &arena, ObjectiveClass *dataManagerClass)
+{
+  dataManagerClass->addImpProperty(arena.make<ObjectiveProperty>("_directory", arena.type("NSString", true)));
+  ObjectiveFunction *dataManagerWithDirectory = arena.make<ObjectiveFunction>("+(instancetype)dataManagerWithDirectory:(NSString *)directory");
+  dataManagerWithDirectory->addLines("if (_sharedDataManager == nil) {");
+  dataManagerWithDirectory->addLines("\t_sharedDataManager = [[DataManager alloc] initWithDirectory:directory];");
+  dataManagerWithDirectory->addLines("}");
+  dataManagerWithDirectory->addLines("return _sharedDataManager;");
+  dataManagerClass->addFunction(dataManagerWithDirectory);
+  
+  ObjectiveFunction *sharedDataManager = arena.make<ObjectiveFunction>("+(DataManager *)sharedDataManager");
+  sharedDataManager->addLines("return _sharedDataManager;");
+  dataManagerClass->addFunction(sharedDataManager);
+  
+  ObjectiveFunction *initFunction = arena.make<ObjectiveFunction>("-(instancetype)initWithDirectory:(NSString *)directory");
+  initFunction->addLines("self = [self init];");
+  initFunction->addLines("if (self) {");
+  initFunction->addLines("\t_directory = directory;");
+  initFunction->addLines("}");
+  initFunction->addLines("return self;");
+  dataManagerClass->addFunction(initFunction);
+  
+  // override in a category or subclass to serve downloaded or cached shards
+  ObjectiveFunction *dataForShard = arena.make<ObjectiveFunction>("-(NSData *)dataForShard:(NSString *)shard");
+  dataForShard->addLines("NSString *fileName = [shard stringByAppendingString:@\".dat\"];");
+  dataForShard->addLines("return [NSData dataWithContentsOfFile:[_directory stringByAppendingPathComponent:fileName]];");
+  dataManagerClass->addFunction(dataForShard);
+}
+
+// a game compiled with DATA_ACCESS_TRACE writes the tables in the order it
+// first asks for them to tmp/data_access.trace, the input of --access-trace
+static void _prepareAccessTrace(ObjectiveArena &arena, ObjectiveFile *dataManagerFile)
+{
+  StaticCPPFunction *traceFunction = arena.make<StaticCPPFunction>("static inline void DataManagerTraceAccess(NSString *table)");
+  traceFunction->addLines("#ifdef DATA_ACCESS_TRACE");
+  traceFunction->addLines("static NSMutableSet *traced;");
+  traceFunction->addLines("static dispatch_once_t once;");
+  traceFunction->addLines("dispatch_once(&once, ^{");
+  traceFunction->addLines("\ttraced = [NSMutableSet new];");
+  traceFunction->addLines("});");
+  traceFunction->addLines("@synchronized (traced) {");
+  traceFunction->addLines("\tif ([traced containsObject:table]) {");
+  traceFunction->addLines("\t\treturn;");
+  traceFunction->addLines("\t}");
+  traceFunction->addLines("\t[traced addObject:table];");
+  traceFunction->addLines("\tNSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@\"data_access.trace\"];");
+  traceFunction->addLines("\t// every launch starts a new trace");
+  traceFunction->addLines("\tFILE *trace = fopen(path.fileSystemRepresentation, traced.count == 1 ? \"w\" : \"a\");");
+  traceFunction->addLines("\tif (trace != NULL) {");
+  traceFunction->addLines("\t\tfprintf(trace, \"%s\\n\", table.UTF8String);");
+  traceFunction->addLines("\t\tfclose(trace);");
+  traceFunction->addLines("\t}");
+  traceFunction->addLines("}");
+  traceFunction->addLines("#endif");
+  dataManagerFile->addStaticCPPFunction(traceFunction);
+}
+
+// checks the CRC-32C of every table in the index before anything is decoded,
+// so a truncated or damaged download fails cleanly instead of inside a Dic
+static void _prepareDataVerification(ObjectiveArena &arena, ObjectiveFile *dataManagerFile)
+{
+  StaticCPPFunction *crcFunction = arena.make<StaticCPPFunction>("static uint32_t DataManagerCrc32c(const uint8_t *bytes, NSUInteger length)");
+  crcFunction->addLines("uint32_t crc = 0xFFFFFFFF;");
+  crcFunction->addLines("#if defined(__ARM_FEATURE_CRC32)");
+  crcFunction->addLines("for (; length >= 8; length -= 8, bytes += 8) {");
+  crcFunction->addLines("\tuint64_t value;");
+  crcFunction->addLines("\tmemcpy(&value, bytes, 8);");
+  crcFunction->addLines("\tcrc = __builtin_arm_crc32cd(crc, value);");
+  crcFunction->addLines("}");
+  crcFunction->addLines("for (; length > 0; --length) {");
+  crcFunction->addLines("\tcrc = __builtin_arm_crc32cb(crc, *bytes++);");
+  crcFunction->addLines("}");
+  crcFunction->addLines("#else");
+  crcFunction->addLines("static uint32_t table[256];");
+  crcFunction->addLines("if (table[1] == 0) {");
+  crcFunction->addLines("\tfor (uint32_t i = 0; i < 256; ++i) {");
+  crcFunction->addLines("\t\tuint32_t value = i;");
+  crcFunction->addLines("\t\tfor (int bit = 0; bit < 8; ++bit) {");
+  crcFunction->addLines("\t\t\tvalue = (value >> 1) ^ (0x82F63B78 & (0 - (value & 1)));");
+  crcFunction->addLines("\t\t}");
+  crcFunction->addLines("\t\ttable[i] = value;");
+  crcFunction->addLines("\t}");
+  crcFunction->addLines("}");
+  crcFunction->addLines("for (; length > 0; --length) {");
+  crcFunction->addLines("\tcrc = (crc >> 8) ^ table[(crc ^ *bytes++) & 0xFF];");
+  crcFunction->addLines("}");
+  crcFunction->addLines("#endif");
+  crcFunction->addLines("return ~crc;");
+  dataManagerFile->addStaticCPPFunction(crcFunction);
+  
+  StaticCPPFunction *verifyFunction = arena.make<StaticCPPFunction>("static BOOL DataManagerVerifyData(NSData *data)");
+  verifyFunction->addLines("const uint8_t *bytes = data.bytes;");
+  verifyFunction->addLines("NSUInteger length = data.length;");
+  verifyFunction->addLines("if (length < 12 || memcmp(bytes + length - 4, \"CSVI\", 4) != 0) {");
+  verifyFunction->addLines("\treturn NO;");
+  verifyFunction->addLines("}");
+  verifyFunction->addLines("uint32_t count, position, tablesEnd = 0;");
+  verifyFunction->addLines("memcpy(&count, bytes + length - 12, 4);");
+  verifyFunction->addLines("memcpy(&position, bytes + length - 8, 4);");
+  verifyFunction->addLines("uint64_t indexEnd = length - 12;");
+  verifyFunction->addLines("for (uint32_t i = 0; i < count; ++i) {");
+  verifyFunction->addLines("\tuint64_t nameLength, schemaLength;");
+  verifyFunction->addLines("\tuint32_t table[3];");
+  verifyFunction->addLines("\tif (position + 8 > indexEnd) {");
+  verifyFunction->addLines("\t\treturn NO;");
+  verifyFunction->addLines("\t}");
+  verifyFunction->addLines("\tmemcpy(&nameLength, bytes + position, 8);");
+  verifyFunction->addLines("\tif (nameLength > indexEnd - position || nameLength + 28 > indexEnd - position) {");
+  verifyFunction->addLines("\t\treturn NO;");
+  verifyFunction->addLines("\t}");
+  verifyFunction->addLines("\tmemcpy(table, bytes + position + 8 + nameLength, 12);");
+  verifyFunction->addLines("\tmemcpy(&schemaLength, bytes + position + 20 + nameLength, 8);");
+  verifyFunction->addLines("\tposition += 28 + nameLength;");
+  verifyFunction->addLines("\tif (schemaLength > indexEnd - position) {");
+  verifyFunction->addLines("\t\treturn NO;");
+  verifyFunction->addLines("\t}");
+  verifyFunction->addLines("\tposition += schemaLength;");
+  verifyFunction->addLines("\tif (table[0] != tablesEnd || (uint64_t)table[0] + table[1] > indexEnd || DataManagerCrc32c(bytes + table[0], table[1]) != table[2]) {");
+  verifyFunction->addLines("\t\treturn NO;");
+  verifyFunction->addLines("\t}");
+  verifyFunction->addLines("\ttablesEnd += table[1];");
+  verifyFunction->addLines("}");
+  verifyFunction->addLines("return YES;");
+  dataManagerFile->addStaticCPPFunction(verifyFunction);
+}
+
+DataBuilder::DataBuilder(const BuildOptions &options)
+{
+  _options = options;
+  if (_options.memoryBudget > 0) {
+    _spillStore = std::make_unique<SpillStore>(_options.spillPath);
+  }
+}
+
+size_t DataBuilder::_readAheadBytes() const
+{
+  if (_options.memoryBudget == 0) {
+    return kReadAheadBytes;
+  }
+  // files waiting to be converted share the budget with the converted ones
+  return _options.memoryBudget > _residentBytes ? _options.memoryBudget - _residentBytes : 0;
+}
+
+bool DataBuilder::_refreshSources(SourceKind kind, vector<SourceFile> &sources)
+{
+  string basePath;
+  vector<string> fileList;
+  if (kind == StringSource) {
+    basePath = _options.stringPath();
+    fileList = getTXTFileList(basePath);
+  } else {
+    basePath = kind == MatrixSource ? _options.matrixPath() : _options.excelPath();
+    fileList = getCSVFileList(basePath);
+  }
+  
+  bool changed = fileList.size() != sources.size();
+  // the sources are moved into refreshed below, keep their names for the comparison
+  vector<string> previousNames;
+  for (const SourceFile &source : sources) {
+    previousNames.push_back(source.fileName);
+  }
+  vector<SourceFile> refreshed;
+  // index into refreshed and whether the source is new
+  vector<pair<size_t, bool>> stale;
+  vector<string> stalePaths;
+  vector<int64_t> staleSizes;
+  for (const string &fileName : fileList) {
+    SourceFile source;
+    source.kind = kind;
+    source.fileName = fileName;
+    for (SourceFile &previous : sources) {
+      if (previous.fileName == fileName) {
+        source = move(previous);
+        previous.residentBytes = 0;
+        break;
+      }
+    }
+    int64_t modifiedTime = -1;
+    int64_t fileSize = -1;
+    _statFile(basePath + fileName, modifiedTime, fileSize);
+    bool isFirst = source.modifiedTime < 0;
+    if (isFirst || modifiedTime != source.modifiedTime || fileSize != source.fileSize) {
+      source.modifiedTime = modifiedTime;
+      source.fileSize = fileSize;
+      stale.push_back(make_pair(refreshed.size(), isFirst));
+      // matrices are streamed line by line from the disk twice instead
+      if (kind != MatrixSource) {
+        stalePaths.push_back(basePath + fileName);
+        staleSizes.push_back(fileSize);
+      }
+      changed = true;
+    }
+    refreshed.push_back(move(source));
+  }
+  if (kind == TableSource) {
+    vector<bool> isStale(refreshed.size(), false);
+    for (const pair<size_t, bool> &source : stale) {
+      isStale[source.first] = true;
+    }
+    // only the Dics ref<> columns point at keep their rows in file order
+    unordered_set<string> &referenced = _options.convert.referencedTables;
+    referenced.clear();
+    for (size_t i = 0; i < refreshed.size(); ++i) {
+      const SourceFile &source = refreshed[i];
+      bool isConverted = !isStale[i] && source.schema.name.size() > 0;
+      for (const string &type : isConverted ? source.schema.propertyTypeList : readTypeRow(basePath + source.fileName)) {
+        string table = _getReferenceTable(type);
+        if (table.size() > 0) {
+          referenced.insert(table);
+        }
+      }
+    }
+    // a table that became a target or stopped being one needs its class again
+    for (size_t i = 0; i < refreshed.size(); ++i) {
+      const TableSchema &schema = refreshed[i].schema;
+      if (!isStale[i] && schema.name.size() > 0 && schema.isReferenced != (referenced.count(schema.name) > 0)) {
+        stale.push_back(make_pair(i, false));
+        stalePaths.push_back(basePath + refreshed[i].fileName);
+        staleSizes.push_back(refreshed[i].fileSize);
+        changed = true;
+      }
+    }
+  }
+  // the next files are read while the current one is converted
+  SourceIngest ingest(stalePaths, staleSizes, _readAheadBytes());
+  for (const pair<size_t, bool> &source : stale) {
+    SourceFile &converted = refreshed[source.first];
+    ingest.setReadAhead(_readAheadBytes());
+    _convertSource(converted, source.second);
+    converted.residentBytes = (converted.segment != nullptr ? converted.segment->size() : 0) + converted.localizedMap.byteSize();
+    _residentBytes += converted.residentBytes;
+    // the sources converted first stay in memory, the ones past the budget are spilled
+    if (_spillStore != nullptr && _residentBytes > _options.memoryBudget) {
+      _spillSource(converted);
+    }
+  }
+  for (int i = 0; !changed && i < refreshed.size(); ++i) {
+    changed = refreshed[i].fileName != previousNames[i];
+  }
+  // files that are gone
+  for (const SourceFile &source : sources) {
+    _residentBytes -= source.residentBytes;
+  }
+  sources = move(refreshed);
+  return changed;
+}
+
+void DataBuilder::_convertSource(SourceFile &source, bool isFirst)
+{
+  source.dirty = true;
+  source.localizedMap.clear();
+  _residentBytes -= source.residentBytes;
+  source.residentBytes = 0;
+  source.spilled = false;
+  FileProfile profile(source.fileName, source.fileSize);
+  Validator validator(source.fileName);
+  if (source.kind == StringSource) {
+    readFile(_options.stringPath(), source.fileName, source.localizedMap, validator);
+    source.errors = validator.errors();
+    return;
+  }
+  
+  source.segment = std::make_unique<bb::ByteBuffer>();
+  TableSchema schema;
+  ObjectiveArena arena;
+  ObjectiveFile *file;
+  if (source.kind == MatrixSource) {
+    file = convertMatriceCSVToObjectiveClass(arena, _options.matrixPath(), source.fileName, source.segment, validator, &schema);
+  } else {
+    file = convertCSVToObjectiveClass(arena, _options.excelPath(), source.fileName, source.localizedMap, source.segment, validator, _options.convert, &schema, &source.links);
+  }
+  source.segmentSize = source.segment->size();
+  Profiler::addBytesOut(source.segmentSize);
+  if (_options.tableIndex) {
+    source.crc = crc32c(0, source.segment->data(), source.segment->size());
+  }
+  source.errors = validator.errors();
+  if (validator.hasErrors()) {
+    // forget the schema so the class is written once the file is fixed
+    source.schema = TableSchema();
+    return;
+  }
+  // data only edits leave the generated class untouched so Xcode doesn't recompile it
+  if (isFirst || schema != source.schema) {
+    file->writeToFile(_options.classPath());
+  }
+  source.schema = schema;
+  if (_options.tableIndex) {
+    source.indexSchema = encodeTableSchema(schema, _options.convert);
+  }
+}
+
+void DataBuilder::_resolveReferences()
+{
+  ProfileScope encodeScope(PhaseEncode, "references");
+  _referenceErrors.clear();
+  map<string, SourceFile *> tablesByName;
+  for (SourceFile &source : _tables) {
+    if (source.kind == TableSource) {
+      tablesByName[source.fileName.substr(0, source.fileName.size() - CSV_EXTENSION.size())] = &source;
+    }
+  }
+  // row index of every id, only for the tables something refers to
+  map<string, unordered_map<string, int32_t>> rowIndexes;
+  for (SourceFile &source : _tables) {
+    if (source.links.references.empty() || source.errors.size() > 0) {
+      continue;
+    }
+    Validator validator(source.fileName);
+    bool changed = false;
+    set<string> reported;
+    // a spilled table comes back for its references and goes again
+    bool restored = source.segment == nullptr;
+    if (restored && !_restoreSegment(source)) {
+      validator.error(0, 0, "spilled data can't be read back");
+      _referenceErrors.insert(_referenceErrors.end(), validator.errors().begin(), validator.errors().end());
+      continue;
+    }
+    for (const TableReference &reference : source.links.references) {
+      auto target = tablesByName.find(reference.table);
+      if (target != tablesByName.end() && target->second->errors.size() > 0) {
+        // the referenced table reports its own errors
+        continue;
+      }
+      if (target == tablesByName.end() || target->second->schema.isGroup) {
+        if (reported.insert(reference.table).second) {
+          validator.error(2, reference.column, "ref<" + reference.table + "> needs a table '" + reference.table + "' with an id or stringId column");
+        }
+        continue;
+      }
+      unordered_map<string, int32_t> &indexes = rowIndexes[reference.table];
+      if (indexes.empty()) {
+        const vector<string> &keys = target->second->links.keys;
+        indexes.reserve(keys.size());
+        for (int32_t i = 0; i < keys.size(); ++i) {
+          indexes.emplace(keys[i], i);
+        }
+      }
+      auto index = indexes.find(reference.id);
+      if (index == indexes.end()) {
+        validator.error(reference.row, reference.column, "'" + reference.id + "' is not an id of " + reference.table);
+        continue;
+      }
+      if ((int32_t)source.segment->getInt(reference.position) != index->second) {
+        source.segment->putInt(index->second, reference.position);
+        changed = true;
+      }
+    }
+    if (changed) {
+      // a table whose own file didn't change is rewritten when the rows it refers to moved
+      source.segment->setWritePos(source.segment->size());
+      source.dirty = true;
+      if (_options.tableIndex) {
+        source.crc = crc32c(0, source.segment->data(), source.segment->size());
+      }
+    }
+    if (restored) {
+      _releaseSegment(source, changed);
+    }
+    _referenceErrors.insert(_referenceErrors.end(), validator.errors().begin(), validator.errors().end());
+  }
+}
+
+void DataBuilder::_spillSource(SourceFile &source)
+{
+  ProfileScope writeScope(PhaseWrite, "spill");
+  if (source.segment != nullptr && !_spillStore->write(source.fileName + ".segment", source.segment->data(), source.segment->size())) {
+    return;
+  }
+  if (!source.localizedMap.writeSortedRun(_spillStore->path(source.fileName + ".strings"))) {
+    return;
+  }
+  source.segment.reset();
+  source.localizedMap.clear();
+  source.spilled = true;
+  _residentBytes -= source.residentBytes;
+  source.residentBytes = 0;
+}
+
+bool DataBuilder::_restoreSegment(SourceFile &source)
+{
+  source.segment = std::make_unique<bb::ByteBuffer>();
+  return _spillStore->read(source.fileName + ".segment", *source.segment);
+}
+
+void DataBuilder::_releaseSegment(SourceFile &source, bool modified)
+{
+  if (modified) {
+    _spillStore->write(source.fileName + ".segment", source.segment->data(), source.segment->size());
+  }
+  source.segment.reset();
+}
+
+void DataBuilder::_writeSegment(SourceFile &source, ostream &out)
+{
+  if (source.segment != nullptr) {
+    out.write((const char *)source.segment->data(), source.segment->size());
+  } else {
+    _spillStore->copyTo(source.fileName + ".segment", out);
+  }
+}
+
+void DataBuilder::_exportArrow(SourceFile &source)
+{
+  ProfileScope writeScope(PhaseWrite, "arrow");
+  bool restored = source.segment == nullptr;
+  if (restored && !_restoreSegment(source)) {
+    source.errors.push_back({source.fileName, 0, 0, "Arrow export failed: spilled data can't be read back"});
+    return;
+  }
+  // read the segment back through its schema, the CSV is only parsed once
+  vector<GameDataTable> index({{source.schema.name, 0, source.segment->size(), 0, encodeTableSchema(source.schema, _options.convert)}});
+  bb::ByteBuffer indexBuffer(0);
+  appendGameDataIndex(indexBuffer, index);
+  string data((const char *)source.segment->data(), source.segment->size());
+  data.append((const char *)indexBuffer.data(), indexBuffer.size());
+  GameDataFile file;
+  string error;
+  const DataTable *table = nullptr;
+  ArrowFormat format = _options.arrowStream ? ArrowStreamFormat : ArrowFileFormat;
+  string path = _options.arrowPath + source.schema.name + (_options.arrowStream ? ".arrows" : ".arrow");
+  if (restored) {
+    _releaseSegment(source, false);
+  }
+  if (!file.load(move(data), error) || (table = file.table(0, error)) == nullptr || !writeArrowTable(*table, path, format, error)) {
+    source.errors.push_back({source.fileName, 0, 0, "Arrow export failed: " + error});
+  }
+}
+
+void DataBuilder::_orderByAccessTrace()
+{
+  // read again every build, a new trace takes effect with the next change
+  vector<string> names;
+  for (SourceFile &source : _tables) {
+    names.push_back(source.fileName.substr(0, source.fileName.size() - CSV_EXTENSION.size()));
+  }
+  vector<SourceFile> ordered;
+  for (size_t index : orderByAccessTrace(names, readAccessTrace(_options.accessTracePath))) {
+    ordered.push_back(move(_tables[index]));
+  }
+  _tables = move(ordered);
+}
+
+void DataBuilder::_writeDataManager()
+{
+  ProfileScope codeGenScope(PhaseCodeGen, "DataManager");
+  ObjectiveArena arena;
+  ObjectiveFile *dataManagerFile = arena.make<ObjectiveFile>(DataManager);
+  ObjectiveClass *dataManagerClass = arena.make<ObjectiveClass>(DataManager);
+  dataManagerFile->addClass(dataManagerClass);
+  ObjectiveType *dataManagerType = arena.type(DataManager, true);
+  ObjectiveProperty *staticProperty = arena.make<ObjectiveProperty>("_sharedDataManager", dataManagerType);
+  dataManagerFile->addStaticProperty(staticProperty);
+  if (_options.convert.columnDescriptors && !_options.convert.columnar) {
+    generateDataDecoder(arena)->writeToFile(_options.classPath());
+  }
+  _dataManagerTables.clear();
+  for (SourceFile &source : _tables) {
+    const TableSchema &schema = source.schema;
+    dataManagerFile->addImportHeaders("\"" + nameChange(schema.name, DataDeclare) + ".h\"");
+    _dataManagerTables.push_back(make_pair(schema.name, schema.isMatrix));
+  }
+  
+  bool traceAccess = _options.accessTracePath.size() > 0;
+  if (traceAccess) {
+    _prepareAccessTrace(arena, dataManagerFile);
+  }
+  if (_options.tableIndex) {
+    _prepareDataVerification(arena, dataManagerFile);
+  }
+  if (_isSharded()) {
+    _prepareShardedDataManager(arena, dataManagerClass);
+    for (const GameDataShard &shard : _shards) {
+      string shardName = nameChange(shard.name, Uppercase);
+      ObjectiveFunction *loadFunction = arena.make<ObjectiveFunction>("-(void)load" + shardName + "Shard");
+      ObjectiveFunction *unloadFunction = arena.make<ObjectiveFunction>("-(void)unload" + shardName + "Shard");
+      loadFunction->addLines("NSData *data = [self dataForShard:@\"" + shard.name + "\"];");
+      if (_options.tableIndex) {
+        loadFunction->addLines("if (!DataManagerVerifyData(data)) {");
+        loadFunction->addLines("\treturn;");
+        loadFunction->addLines("}");
+      }
+      loadFunction->addLines("ByteBuffer *buffer = [[ByteBuffer alloc] initWithData:data];");
+      dataManagerClass->addFunction(loadFunction);
+      dataManagerClass->addFunction(unloadFunction);
+      for (size_t table : shard.tables) {
+        const TableSchema &schema = _tables[table].schema;
+        _prepareDataManager(arena, schema.name, dataManagerClass, loadFunction, schema.isMatrix, traceAccess, shard.name);
+        unloadFunction->addLines((schema.isMatrix ? nameChange(schema.name, DataImp) : nameChange(schema.name, DataDicImp)) + " = nil;");
+      }
+    }
+    dataManagerFile->writeToFile(_options.classPath());
+    return;
+  }
+  
+  ObjectiveFunction *dataManagerInitFunction = arena.make<ObjectiveFunction>("-(instancetype)initWithData:(NSData *)data");
+  dataManagerClass->addFunction(dataManagerInitFunction);
+  if (_options.tableIndex) {
+    dataManagerInitFunction->addLines("if (!DataManagerVerifyData(data)) {");
+    dataManagerInitFunction->addLines("\treturn nil;");
+    dataManagerInitFunction->addLines("}");
+  }
+  dataManagerInitFunction->addLines("self = [self init];");
+  dataManagerInitFunction->addLines("if (self) {");
+  dataManagerInitFunction->addLines("\tByteBuffer *buffer = [[ByteBuffer alloc] initWithData:data];");
+  _prepareDataManager(arena, dataManagerClass);
+  for (SourceFile &source : _tables) {
+    const TableSchema &schema = source.schema;
+    _prepareDataManager(arena, schema.name, dataManagerClass, dataManagerInitFunction, schema.isMatrix, traceAccess);
+  }
+  
+  dataManagerInitFunction->addLines("}");
+  dataManagerInitFunction->addLines("return self;");
+  dataManagerFile->writeToFile(_options.classPath());
+}
+
+void DataBuilder::_writeShards()
+{
+  ProfileScope writeScope(PhaseWrite, "shards");
+  string manifest;
+  for (const GameDataShard &shard : _shards) {
+    bool dirty = !_hasBuilt;
+    vector<GameDataTable> index;
+    uint32_t offset = 0;
+    for (size_t table : shard.tables) {
+      const SourceFile &source = _tables[table];
+      dirty = dirty || source.dirty;
+      index.push_back({source.schema.name, offset, source.segmentSize, source.crc, source.indexSchema});
+      offset += source.segmentSize;
+    }
+    bb::ByteBuffer indexBuffer(0);
+    if (_options.tableIndex) {
+      appendGameDataIndex(indexBuffer, index);
+    }
+    // clients check downloads against this, so it is the size of the whole file
+    size_t fileSize = shard.size + indexBuffer.size();
+    manifest += shard.name + ".dat " + to_string(fileSize);
+    for (size_t table : shard.tables) {
+      manifest += " " + _tables[table].schema.name;
+    }
+    manifest += "\n";
+    // shards whose tables didn't change keep their file, clients don't download them again
+    if (!dirty && _shardLayout == _writtenShardLayout) {
+      continue;
+    }
+    ofstream outfile(_options.resourcePath() + shard.name + ".dat", ofstream::binary);
+    for (size_t table : shard.tables) {
+      _writeSegment(_tables[table], outfile);
+    }
+    outfile.write((const char *)indexBuffer.data(), indexBuffer.size());
+    cout << shard.name << ".dat " << fileSize << endl;
+  }
+  for (SourceFile &source : _tables) {
+    source.dirty = false;
+  }
+  _writtenShardLayout = _shardLayout;
+  ofstream manifestStream(_options.resourcePath() + "game.manifest");
+  manifestStream.write(manifest.data(), manifest.size());
+}
+
+void DataBuilder::_planShards()
+{
+  Validator validator(_options.shardMapPath.size() > 0 ? _options.shardMapPath : "shards");
+  if (_options.shardMapPath.size() > 0) {
+    readShardMap(_options.shardMapPath, _shardMap, validator);
+  }
+  vector<pair<string, uint32_t>> tables;
+  for (SourceFile &source : _tables) {
+    tables.push_back(make_pair(source.schema.name, source.segmentSize));
+  }
+  _shards = planShards(tables, _shardMap, _options.shardBudget, validator);
+  _shardLayout.assign(_tables.size(), string());
+  for (const GameDataShard &shard : _shards) {
+    for (size_t table : shard.tables) {
+      _shardLayout[table] = shard.name;
+    }
+  }
+  _errors.insert(_errors.end(), validator.errors().begin(), validator.errors().end());
+}
+
+void DataBuilder::_writeGameData()
+{
+  if (_isSharded()) {
+    _writeShards();
+    return;
+  }
+  ProfileScope writeScope(PhaseWrite, "game.dat");
+  string gameDataPath = _options.resourcePath() + "game.dat";
+  vector<pair<string, uint32_t>> layout;
+  vector<GameDataTable> index;
+  uint32_t size = 0;
+  // in table order, so a reordered game.dat is written from scratch
+  for (SourceFile &source : _tables) {
+    layout.push_back(make_pair(source.fileName, source.segmentSize));
+    index.push_back({source.schema.name, size, source.segmentSize, source.crc, source.indexSchema});
+    size += source.segmentSize;
+  }
+  bb::ByteBuffer indexBuffer(0);
+  if (_options.tableIndex) {
+    appendGameDataIndex(indexBuffer, index);
+  }
+  // a renamed column changes the schema in the index but not the table sizes
+  layout.push_back(make_pair(string(), indexBuffer.size()));
+  
+  if (layout == _gameDataLayout) {
+    // every table kept its place and size, only overwrite the tables that changed
+    fstream outfile(gameDataPath, fstream::in | fstream::out | fstream::binary);
+    uint32_t offset = 0;
+    for (SourceFile &source : _tables) {
+      if (source.dirty) {
+        outfile.seekp(offset);
+        _writeSegment(source, outfile);
+        source.dirty = false;
+      }
+      offset += source.segmentSize;
+    }
+    // the checksums of the rewritten tables changed
+    outfile.seekp(offset);
+    outfile.write((const char *)indexBuffer.data(), indexBuffer.size());
+    return;
+  }
+  
+  cout << size << endl;
+  ofstream outfile(gameDataPath, ofstream::binary);
+  for (SourceFile &source : _tables) {
+    _writeSegment(source, outfile);
+    source.dirty = false;
+  }
+  outfile.write((const char *)indexBuffer.data(), indexBuffer.size());
+  _gameDataLayout = layout;
+}
+
+static void _appendEscaped(string &content, const StringRef &text)
+{
+  for (size_t i = 0; i < text.size; ++i) {
+    if (text.data[i] == '"') {
+      content += '\\';
+    }
+    content += text.data[i];
+  }
+}
+
+void DataBuilder::_mergeLocalizedStrings()
+{
+  ProfileScope localizeScope(PhaseLocalize, "merge strings");
+  // every source is one run sorted by key, a spilled one is read back from its file
+  struct Run
+  {
+    const SourceFile *source;
+    vector<LocalizedStringTable::Entry> entries;
+    size_t position = 0;
+    LocalizedRunReader reader;
+    LocalizedStringTable::Entry entry;
+    
+    bool next() {
+      if (source->spilled) {
+        return reader.next(entry);
+      }
+      if (position == entries.size()) {
+        return false;
+      }
+      entry = entries[position++];
+      return true;
+    }
+  };
+  // by file name, tables first and then the .txt files, so neither the access
+  // trace nor the directory order decides which file wins a key
+  vector<const SourceFile *> ordered;
+  for (vector<SourceFile> *sources : {&_tables, &_strings}) {
+    size_t first = ordered.size();
+    for (const SourceFile &source : *sources) {
+      ordered.push_back(&source);
+    }
+    sort(ordered.begin() + first, ordered.end(), [](const SourceFile *a, const SourceFile *b) { return a->fileName < b->fileName; });
+  }
+  vector<unique_ptr<Run>> runs;
+  for (const SourceFile *source : ordered) {
+    unique_ptr<Run> run = std::make_unique<Run>();
+    run->source = source;
+    if (source->spilled) {
+      run->reader.open(_spillStore->path(source->fileName + ".strings"));
+    } else {
+      run->entries = source->localizedMap.sortedEntries();
+    }
+    if (run->next()) {
+      runs.push_back(move(run));
+    }
+  }
+  // a min heap on the key, equal keys come out in source order and the last source wins
+  auto after = [&runs](size_t a, size_t b) {
+    const StringRef &keyA = runs[a]->entry.key;
+    const StringRef &keyB = runs[b]->entry.key;
+    return keyB < keyA || (keyA == keyB && a > b);
+  };
+  vector<size_t> heap;
+  for (size_t i = 0; i < runs.size(); ++i) {
+    heap.push_back(i);
+  }
+  make_heap(heap.begin(), heap.end(), after);
+  
+  _localizedErrors.clear();
+  _localizedContent.clear();
+  ofstream spillStream;
+  if (_spillStore != nullptr) {
+    spillStream.open(_spillStore->path("Localizable.strings"), ofstream::binary | ofstream::trunc);
+  }
+  vector<size_t> group;
+  while (!heap.empty()) {
+    group.clear();
+    do {
+      pop_heap(heap.begin(), heap.end(), after);
+      group.push_back(heap.back());
+      heap.pop_back();
+    } while (!heap.empty() && runs[heap.front()]->entry.key == runs[group[0]]->entry.key);
+    for (size_t i = 1; i < group.size(); ++i) {
+      const Run &run = *runs[group[i]];
+      _localizedErrors.push_back({run.source->fileName, 0, 0,
+        "key '" + run.entry.key.str() + "' is already defined by " + runs[group[i - 1]]->source->fileName});
+    }
+    const LocalizedStringTable::Entry &entry = runs[group.back()]->entry;
+    _localizedContent += '"';
+    _appendEscaped(_localizedContent, entry.key);
+    _localizedContent += "\" = \"";
+    _appendEscaped(_localizedContent, entry.value);
+    _localizedContent += "\";\n";
+    for (size_t run : group) {
+      if (runs[run]->next()) {
+        heap.push_back(run);
+        push_heap(heap.begin(), heap.end(), after);
+      }
+    }
+    if (spillStream.is_open() && _localizedContent.size() >= kSpillChunk) {
+      spillStream.write(_localizedContent.data(), _localizedContent.size());
+      _localizedContent.clear();
+    }
+  }
+  if (spillStream.is_open()) {
+    spillStream.write(_localizedContent.data(), _localizedContent.size());
+    string().swap(_localizedContent);
+  }
+}
+
+void DataBuilder::_writeLocalizedStrings()
+{
+  ProfileScope localizeScope(PhaseLocalize, "Localizable.strings");
+  ofstream localStringStream(_options.resourcePath() + "Localizable.strings");
+  if (_spillStore != nullptr) {
+    _spillStore->copyTo("Localizable.strings", localStringStream);
+    return;
+  }
+  localStringStream.write(_localizedContent.data(), _localizedContent.size());
+}
+
+bool DataBuilder::build()
+{
+  vector<SourceFile> tables;
+  vector<SourceFile> matrices;
+  for (SourceFile &source : _tables) {
+    (source.kind == MatrixSource ? matrices : tables).push_back(move(source));
+  }
+  bool tablesChanged = _refreshSources(TableSource, tables);
+  bool matricesChanged = _refreshSources(MatrixSource, matrices);
+  _tables = move(tables);
+  for (SourceFile &source : matrices) {
+    _tables.push_back(move(source));
+  }
+  if (_options.accessTracePath.size() > 0) {
+    _orderByAccessTrace();
+  }
+  if (tablesChanged || matricesChanged) {
+    _resolveReferences();
+    for (SourceFile &source : _tables) {
+      if (_options.arrowPath.size() > 0 && source.dirty && source.errors.empty()) {
+        _exportArrow(source);
+      }
+    }
+  }
+  
+  bool stringsChanged = _refreshSources(StringSource, _strings);
+  bool localizedChanged = !_hasBuilt || tablesChanged || stringsChanged;
+  if (localizedChanged) {
+    _mergeLocalizedStrings();
+  }
+  
+  _errors.clear();
+  for (vector<SourceFile> *sources : {&_tables, &_strings}) {
+    for (SourceFile &source : *sources) {
+      _errors.insert(_errors.end(), source.errors.begin(), source.errors.end());
+    }
+  }
+  _errors.insert(_errors.end(), _localizedErrors.begin(), _localizedErrors.end());
+  _errors.insert(_errors.end(), _referenceErrors.begin(), _referenceErrors.end());
+  if (_isSharded() && _errors.empty()) {
+    _planShards();
+  }
+  if (_errors.size() > 0) {
+    printValidationErrors(cerr, _errors);
+    cerr << "build failed with " << _errors.size() << " error(s)" << endl;
+    // the next clean build has to write everything again
+    _hasBuilt = false;
+    return true;
+  }
+  
+  vector<pair<string, bool>> dataManagerTables;
+  for (SourceFile &source : _tables) {
+    dataManagerTables.push_back(make_pair(source.schema.name, source.schema.isMatrix));
+  }
+  // a new access trace reorders the tables, DataManager and game.dat have to agree on the order
+  bool orderChanged = dataManagerTables != _dataManagerTables;
+  if (!_hasBuilt || orderChanged || _shardLayout != _writtenShardLayout) {
+    _writeDataManager();
+  }
+  if (!_hasBuilt || tablesChanged || matricesChanged || orderChanged || _shardLayout != _writtenShardLayout) {
+    _writeGameData();
+  }
+  if (localizedChanged) {
+    _writeLocalizedStrings();
+  }
+  _hasBuilt = true;
+  return tablesChanged || matricesChanged || stringsChanged;
+}
@@ -0,0 +1,109 @@
+//
+//  DataBuilder.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef DataBuilder_hpp
+#define DataBuilder_hpp
+
+#include <stdio.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BuildOptions.hpp"
+#include "ByteBuffer.hpp"
+#include "LocalizedStringTable.hpp"
+#include "ReadCSVFile.hpp"
+#include "ShardPlan.hpp"
+#include "SpillStore.hpp"
+#include "Validator.hpp"
+
+using namespace std;
+
+enum SourceKind { TableSource, MatrixSource, StringSource };
+
+// Keeps every converted source resident so a rebuild only has to convert the
+// files whose stamp changed, then reassembles DataManager, game.dat and
+// Localizable.strings from what is already in memory. Under --memory-mb the
+// sources converted once the budget is used up go to temporary files and are
+// streamed from there into the output.
+class DataBuilder
+{
+private:
+  struct SourceFile
+  {
+    SourceKind kind;
+    string fileName;
+    int64_t modifiedTime = -1;
+    int64_t fileSize = -1;
+    bool dirty = true;
+    // nullptr while the segment is spilled, segmentSize is always valid
+    unique_ptr<bb::ByteBuffer> segment;
+    uint32_t segmentSize = 0;
+    // segment and localizedMap moved to the spill store to stay in the memory budget
+    bool spilled = false;
+    // what this source adds to _residentBytes
+    size_t residentBytes = 0;
+    // CRC-32C of segment for the table index
+    uint32_t crc = 0;
+    // schema bytes of the table index entry
+    string indexSchema;
+    LocalizedStringTable localizedMap;
+    TableSchema schema;
+    // row ids and ref<table> cells, the cells are filled in by _resolveReferences
+    TableLinks links;
+    vector<ValidationError> errors;
+  };
+  
+  BuildOptions _options;
+  bool _hasBuilt = false;
+  vector<SourceFile> _tables;
+  vector<SourceFile> _strings;
+  vector<pair<string, bool>> _dataManagerTables;
+  vector<pair<string, uint32_t>> _gameDataLayout;
+  // Localizable.strings, kept in the spill store under a memory budget
+  string _localizedContent;
+  vector<ValidationError> _localizedErrors;
+  vector<ValidationError> _referenceErrors;
+  vector<ValidationError> _errors;
+  map<string, string> _shardMap;
+  vector<GameDataShard> _shards;
+  // shard of every table, the DataManager and all shards are rewritten when it changes
+  vector<string> _shardLayout;
+  vector<string> _writtenShardLayout;
+  unique_ptr<SpillStore> _spillStore;
+  size_t _residentBytes = 0;
+  
+  bool _isSharded() const { return _options.shardMapPath.size() > 0 || _options.shardBudget > 0; }
+  size_t _readAheadBytes() const;
+  bool _refreshSources(SourceKind kind, vector<SourceFile> &sources);
+  void _convertSource(SourceFile &source, bool isFirst);
+  void _spillSource(SourceFile &source);
+  // brings a spilled segment back for a while, release writes it out again if it was modified
+  bool _restoreSegment(SourceFile &source);
+  void _releaseSegment(SourceFile &source, bool modified);
+  void _writeSegment(SourceFile &source, ostream &out);
+  void _resolveReferences();
+  // tables of the access trace first, the rest keep their order behind them
+  void _orderByAccessTrace();
+  void _exportArrow(SourceFile &source);
+  void _writeDataManager();
+  void _writeGameData();
+  void _planShards();
+  void _writeShards();
+  void _mergeLocalizedStrings();
+  void _writeLocalizedStrings();
+public:
+  DataBuilder(const BuildOptions &options);
+  // converts whatever changed since the last call, returns false if nothing did.
+  // Nothing is written while any source has validation errors, the build still
+  // returns true then and errors() is not empty.
+  bool build();
+  const vector<ValidationError> &errors() const { return _errors; }
+};
+
+#endif /* DataBuilder_hpp */
@@ -0,0 +1,193 @@
+//
+//  DataGenerator.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "DataGenerator.hpp"
+#include <fstream>
+#include <vector>
+#include <sys/stat.h>
+
+using namespace std;
+
+// xorshift64*, the standard distributions are not guaranteed to give the
+// same numbers on every library so the generator rolls its own
+class GeneratorRandom
+{
+private:
+  uint64_t _state;
+public:
+  GeneratorRandom(uint64_t seed) : _state(seed ? seed : 1) {}
+  uint64_t next() {
+    _state ^= _state >> 12;
+    _state ^= _state << 25;
+    _state ^= _state >> 27;
+    return _state * 2685821657736338717ULL;
+  }
+  int range(int low, int high) { return low + (int)(next() % (uint64_t)(high - low + 1)); }
+  const string &pick(const vector<string> &list) { return list[next() % list.size()]; }
+};
+
+static const vector<string> kWords({"iron", "oak", "silk", "amber", "salt", "pearl", "spice", "tea",
+  "copper", "ivory", "wool", "cedar", "jade", "coral", "indigo", "saffron"});
+static const vector<string> kLocalizedWords({"Sword", "Compass", "Anchor", "Lantern", "Map",
+  "丝绸", "瓷器", "茶叶", "香料", "Ship's \"Bell\""});
+
+static void _makeDirectories(const string &path)
+{
+  for (size_t pos = path.find('/', 1); pos != string::npos; pos = path.find('/', pos + 1)) {
+    mkdir(path.substr(0, pos).c_str(), 0755);
+  }
+  mkdir(path.c_str(), 0755);
+}
+
+static void _writeLines(const string &path, const vector<string> &lines, char lineEnd, DataSetStats &stats)
+{
+  ofstream outfile(path, ofstream::binary);
+  for (const string &line : lines) {
+    outfile << line << lineEnd;
+    stats.bytes += line.size() + 1;
+  }
+  stats.files++;
+}
+
+static string _list(GeneratorRandom &random, const string &prefix, int maxCount)
+{
+  string value;
+  int count = random.range(1, maxCount);
+  for (int i = 0; i < count; ++i) {
+    if (i > 0) {
+      value += ";";
+    }
+    value += prefix + to_string(random.range(0, 999));
+  }
+  return value;
+}
+
+static string _cell(GeneratorRandom &random, const string &type, int row)
+{
+  if (type == "int") {
+    return to_string(random.range(-1000, 100000));
+  } else if (type == "long" || type == "NSInteger") {
+    return to_string((long long)(random.next() >> 20));
+  } else if (type == "double") {
+    return to_string(random.range(0, 1000000) / 1000.0);
+  } else if (type == "set") {
+    return _list(random, "item", 6);
+  } else if (type == "array") {
+    return _list(random, "", 12);
+  } else if (type == "comment") {
+    return "note " + to_string(row) + " " + random.pick(kWords);
+  }
+  return random.pick(kWords) + "_" + random.pick(kWords) + "_" + to_string(row);
+}
+
+static void _writeTable(const string &path,
+                        GeneratorRandom &random,
+                        const string &keyType,
+                        const string &keyPrefix,
+                        const vector<pair<string, string>> &columns,
+                        int rowCount,
+                        DataSetStats &stats)
+{
+  vector<string> lines;
+  string header = keyPrefix + "Id";
+  string types = keyType;
+  for (const pair<string, string> &column : columns) {
+    header += "," + column.first;
+    types += "," + column.second;
+  }
+  lines.push_back(header);
+  lines.push_back(types);
+  for (int row = 0; row < rowCount; ++row) {
+    string line = keyType == "groupId" ? keyPrefix + to_string(row % 97) : keyPrefix + to_string(row);
+    for (const pair<string, string> &column : columns) {
+      // tabs and commas both separate cells in the exported sheets
+      line += (row % 7 == 0) ? "\t" : ",";
+      if (!column.second.compare(0, 5, "name_")) {
+        line += random.pick(kLocalizedWords) + " " + to_string(row);
+      } else {
+        line += _cell(random, column.second, row);
+      }
+    }
+    lines.push_back(line);
+  }
+  _writeLines(path, lines, '\r', stats);
+  stats.rows += rowCount;
+}
+
+DataSetStats generateDataSet(const string &rootPath, const DataSetSpec &spec)
+{
+  DataSetStats stats;
+  GeneratorRandom random(spec.seed);
+  int scale = spec.scale > 0 ? spec.scale : 1;
+  string excelPath = rootPath + "DataSource/excel/";
+  string matrixPath = rootPath + "DataSource/Matrix/";
+  string stringPath = rootPath + "DataSource/string/";
+  _makeDirectories(excelPath);
+  _makeDirectories(matrixPath);
+  _makeDirectories(stringPath);
+  _makeDirectories(rootPath + "FileTestProject/Resources/");
+  _makeDirectories(rootPath + "FileTestProject/Classes/DataProcessing/");
+  
+  // wide table, every scalar type and both localization columns
+  vector<pair<string, string>> wideColumns;
+  const vector<string> scalarTypes({"int", "long", "double", "NSInteger", "string"});
+  for (int i = 0; i < 32; ++i) {
+    wideColumns.push_back(make_pair("attr" + to_string(i), scalarTypes[i % scalarTypes.size()]));
+  }
+  wideColumns.push_back(make_pair("goodsName", "name_goodsName"));
+  wideColumns.push_back(make_pair("goodsDesc", "name_goodsDesc"));
+  wideColumns.push_back(make_pair("tags", "set"));
+  wideColumns.push_back(make_pair("levels", "array"));
+  wideColumns.push_back(make_pair("remark", "comment"));
+  _writeTable(excelPath + "goods.csv", random, "id", "goods", wideColumns, 2000 * scale, stats);
+  
+  // narrow tables, one per key flavour
+  _writeTable(excelPath + "loot.csv", random, "groupId", "lootGroup",
+              {{"itemId", "string"}, {"weight", "int"}, {"amount", "int"}}, 8000 * scale, stats);
+  _writeTable(excelPath + "dialog.csv", random, "stringId", "dialog",
+              {{"speaker", "string"}, {"dialogText", "name_dialogText"}}, 3000 * scale, stats);
+  
+  // collection heavy table
+  _writeTable(excelPath + "recipe.csv", random, "id", "recipe",
+              {{"inputs", "array"}, {"outputs", "array"}, {"stations", "set"},
+               {"duration", "double"}, {"recipeName", "name_recipeName"}}, 3000 * scale, stats);
+  
+  // matrix, first row is function name, column name and the column keys
+  int matrixSize = 120 * scale;
+  vector<string> lines;
+  string header = "distanceOf,toCity";
+  for (int col = 0; col < matrixSize; ++col) {
+    header += ",city" + to_string(col);
+  }
+  lines.push_back(header);
+  lines.push_back("fromCity,int");
+  for (int row = 0; row < matrixSize; ++row) {
+    string line = "city" + to_string(row) + ",from city " + to_string(row);
+    for (int col = 0; col < matrixSize; ++col) {
+      line += "," + to_string(random.range(0, 20000));
+    }
+    lines.push_back(line);
+  }
+  _writeLines(matrixPath + "distance.csv", lines, '\r', stats);
+  stats.rows += matrixSize;
+  
+  // strings, one plain file keyed by line number and one "key" = "value"; file
+  lines.clear();
+  for (int i = 0; i < 2000 * scale; ++i) {
+    lines.push_back(random.pick(kLocalizedWords) + " " + random.pick(kWords) + " " + to_string(i));
+  }
+  _writeLines(stringPath + "story.txt", lines, '\n', stats);
+  stats.rows += lines.size();
+  lines.clear();
+  for (int i = 0; i < 500 * scale; ++i) {
+    lines.push_back("\"ui_" + to_string(i) + "\" = \"" + random.pick(kWords) + " " + to_string(i) + "\";");
+  }
+  _writeLines(stringPath + "ui.txt", lines, '\n', stats);
+  stats.rows += lines.size();
+  return stats;
+}
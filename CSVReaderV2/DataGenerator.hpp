@@ -0,0 +1,38 @@
+//
+//  DataGenerator.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef DataGenerator_hpp
+#define DataGenerator_hpp
+
+#include <stdio.h>
+#include <string>
+
+using namespace std;
+
+struct DataSetSpec
+{
+  // multiplies the row count of every table and the size of every matrix
+  int scale = 1;
+  uint64_t seed = 2017;
+};
+
+struct DataSetStats
+{
+  size_t files = 0;
+  size_t bytes = 0;
+  size_t rows = 0;
+};
+
+// Writes a deterministic project tree (DataSource/excel, Matrix and string
+// plus the FileTestProject output folders) under rootPath that looks like
+// our real sheets: wide and narrow tables keyed by id, groupId and stringId,
+// name_ localization columns, set/array columns, a large matrix and both
+// flavours of .txt string files.
+DataSetStats generateDataSet(const string &rootPath, const DataSetSpec &spec);
+
+#endif /* DataGenerator_hpp */
@@ -0,0 +1,75 @@
+//
+//  FileWatcher.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "FileWatcher.hpp"
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+// editors and spreadsheet apps save through several writes and renames, wait
+// for the directory to stay quiet this long before reporting a change
+static const int kSettleMs = 30;
+
+FileWatcher::FileWatcher(int pollIntervalMs)
+{
+  _pollIntervalMs = pollIntervalMs;
+  _notifyFd = -1;
+#ifdef __linux__
+  _notifyFd = inotify_init1(IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+  if (_notifyFd >= 0) {
+    close(_notifyFd);
+  }
+}
+
+void FileWatcher::addDirectory(const string &path)
+{
+  _directories.push_back(path);
+#ifdef __linux__
+  if (_notifyFd >= 0) {
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+    if (inotify_add_watch(_notifyFd, path.c_str(), mask) < 0) {
+      perror(path.c_str());
+    }
+  }
+#endif
+}
+
+bool FileWatcher::isNative() const
+{
+  return _notifyFd >= 0;
+}
+
+void FileWatcher::waitForChanges()
+{
+#ifdef __linux__
+  if (_notifyFd >= 0) {
+    char events[4096];
+    pollfd fd = {_notifyFd, POLLIN, 0};
+    if (poll(&fd, 1, -1) <= 0) {
+      return;
+    }
+    do {
+      if (read(_notifyFd, events, sizeof(events)) <= 0) {
+        break;
+      }
+    } while (poll(&fd, 1, kSettleMs) > 0);
+    return;
+  }
+#endif
+  this_thread::sleep_for(chrono::milliseconds(_pollIntervalMs));
+}
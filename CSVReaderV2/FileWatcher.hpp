@@ -0,0 +1,35 @@
+//
+//  FileWatcher.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef FileWatcher_hpp
+#define FileWatcher_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Blocks until something in the watched directories may have changed. It
+// uses inotify where available and falls back to sleeping for the poll
+// interval, the caller always rescans to find out what actually changed.
+class FileWatcher
+{
+private:
+  vector<string> _directories;
+  int _pollIntervalMs;
+  int _notifyFd;
+public:
+  FileWatcher(int pollIntervalMs);
+  ~FileWatcher();
+  void addDirectory(const string &path);
+  bool isNative() const;
+  void waitForChanges();
+};
+
+#endif /* FileWatcher_hpp */
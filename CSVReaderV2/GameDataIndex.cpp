@@ -0,0 +1,150 @@
+//
+//  GameDataIndex.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "GameDataIndex.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include "Crc32c.hpp"
+
+static const char kIndexMagic[] = "CSVI";
+static const size_t kFooterSize = 12;
+
+void appendGameDataIndex(bb::ByteBuffer &buffer, const vector<GameDataTable> &tables)
+{
+  // the index follows the last table
+  uint32_t start = tables.size() > 0 ? tables.back().offset + tables.back().size : 0;
+  for (const GameDataTable &table : tables) {
+    buffer.putString(table.name);
+    buffer.putInt(table.offset);
+    buffer.putInt(table.size);
+    buffer.putInt(table.crc);
+    buffer.putString(table.schema);
+  }
+  buffer.putInt((uint32_t)tables.size());
+  buffer.putInt(start);
+  buffer.putBytes((uint8_t *)kIndexMagic, 4);
+}
+
+static uint32_t _readInt(const char *data)
+{
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// entries is the part between the last table and the footer
+static bool _readEntries(const char *entries, size_t length, uint32_t count, vector<GameDataTable> &tables)
+{
+  uint32_t tablesEnd = 0;
+  size_t position = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (position + 8 > length) {
+      return false;
+    }
+    uint64_t nameLength;
+    memcpy(&nameLength, entries + position, sizeof(nameLength));
+    position += 8;
+    if (nameLength > length - position || length - position - nameLength < 12) {
+      return false;
+    }
+    GameDataTable table;
+    table.name.assign(entries + position, nameLength);
+    position += nameLength;
+    table.offset = _readInt(entries + position);
+    table.size = _readInt(entries + position + 4);
+    table.crc = _readInt(entries + position + 8);
+    position += 12;
+    uint64_t schemaLength;
+    if (length - position < 8) {
+      return false;
+    }
+    memcpy(&schemaLength, entries + position, sizeof(schemaLength));
+    position += 8;
+    if (schemaLength > length - position) {
+      return false;
+    }
+    table.schema.assign(entries + position, schemaLength);
+    position += schemaLength;
+    if (table.offset != tablesEnd) {
+      return false;
+    }
+    tablesEnd += table.size;
+    tables.push_back(table);
+  }
+  return position == length;
+}
+
+bool readGameDataIndex(const string &data, vector<GameDataTable> &tables)
+{
+  tables.clear();
+  if (data.size() < kFooterSize || data.compare(data.size() - 4, 4, kIndexMagic) != 0) {
+    return false;
+  }
+  size_t footer = data.size() - kFooterSize;
+  uint32_t count = _readInt(data.data() + footer);
+  uint32_t start = _readInt(data.data() + footer + 4);
+  if (start > footer || !_readEntries(data.data() + start, footer - start, count, tables) ||
+      (tables.size() > 0 && tables.back().offset + tables.back().size != start)) {
+    tables.clear();
+    return false;
+  }
+  return true;
+}
+
+int verifyGameDataFile(const string &path)
+{
+  ifstream indata(path, ifstream::binary);
+  indata.seekg(0, ios::end);
+  int64_t fileSize = indata ? (int64_t)indata.tellg() : -1;
+  if (fileSize < 0) {
+    cerr << "can't read " << path << endl;
+    return 1;
+  }
+  char footer[kFooterSize];
+  indata.seekg(max<int64_t>(0, fileSize - kFooterSize));
+  if (fileSize < kFooterSize || !indata.read(footer, kFooterSize) || memcmp(footer + 8, kIndexMagic, 4) != 0) {
+    cerr << path << ": no table index, it is truncated or was built without --table-index" << endl;
+    return 1;
+  }
+  uint32_t count = _readInt(footer);
+  uint32_t start = _readInt(footer + 4);
+  size_t indexEnd = fileSize - kFooterSize;
+  string entries(start <= indexEnd ? indexEnd - start : 0, '\0');
+  vector<GameDataTable> tables;
+  indata.seekg(start);
+  if (start > indexEnd || !indata.read(&entries[0], entries.size()) || !_readEntries(entries.data(), entries.size(), count, tables) ||
+      (tables.size() > 0 && tables.back().offset + tables.back().size != start)) {
+    cerr << path << ": the table index is damaged" << endl;
+    return 1;
+  }
+  
+  auto begin = chrono::steady_clock::now();
+  vector<char> chunk(1 << 20);
+  int failures = 0;
+  indata.seekg(0);
+  for (const GameDataTable &table : tables) {
+    uint32_t crc = 0;
+    for (uint32_t remaining = table.size; remaining > 0 && indata; ) {
+      uint32_t length = min<uint32_t>(remaining, (uint32_t)chunk.size());
+      indata.read(chunk.data(), length);
+      crc = crc32c(crc, chunk.data(), length);
+      remaining -= length;
+    }
+    if (!indata || crc != table.crc) {
+      cerr << path << ": table " << table.name << " is corrupted" << endl;
+      failures++;
+    }
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+  cout << tables.size() << " tables, " << start << " bytes checked in " << seconds * 1e3 << " ms ("
+       << (seconds > 0 ? start / seconds / (1024.0 * 1024.0 * 1024.0) : 0.0) << " GB/s"
+       << (crc32cIsHardware() ? "" : ", no crc32 instruction") << ")" << endl;
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+//
+//  GameDataIndex.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef GameDataIndex_hpp
+#define GameDataIndex_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ByteBuffer.hpp"
+
+using namespace std;
+
+// Where every table sits in game.dat. The index is appended after the last
+// table, the generated DataManager reads the tables front to back and never
+// reaches it. Layout, all integers little endian:
+//   per table: name (uint64 length + bytes), uint32 offset, uint32 size,
+//              uint32 CRC-32C of the table, schema (uint64 length + bytes)
+//   uint32 table count, uint32 offset of the first entry, "CSVI"
+struct GameDataTable
+{
+  string name;
+  uint32_t offset;
+  uint32_t size;
+  uint32_t crc;
+  // columns and encodings, see GameDataReader.hpp
+  string schema;
+};
+
+// buffer is whatever follows the last table, usually an empty one
+void appendGameDataIndex(bb::ByteBuffer &buffer, const vector<GameDataTable> &tables);
+// false when data has no index, tables is left empty then
+bool readGameDataIndex(const string &data, vector<GameDataTable> &tables);
+// --verify, streams every table of the file through crc32c and returns the exit code
+int verifyGameDataFile(const string &path);
+
+#endif /* GameDataIndex_hpp */
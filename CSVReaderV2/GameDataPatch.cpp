@@ -0,0 +1,353 @@
+//
+//  GameDataPatch.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "GameDataPatch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "GameDataIndex.hpp"
+#include "ReadCSVFile.hpp"
+
+static const char kPatchMagic[] = "CSVP";
+static const uint32_t kPatchVersion = 1;
+// bytes a match has to share before it is worth a copy operation
+static const size_t kBlockSize = 16;
+// new data without an index is matched in chunks of this size so it still spreads over threads
+static const size_t kChunkSize = 1 << 20;
+static const uint32_t kHashBase = 257;
+
+// one piece of the new file and the part of the old file it is matched against
+struct PatchSection
+{
+  size_t newBegin;
+  size_t newEnd;
+  size_t oldBegin;
+  size_t oldEnd;
+  string operations;
+  size_t copiedBytes = 0;
+  size_t insertedBytes = 0;
+};
+
+typedef unordered_map<uint32_t, uint32_t> BlockIndex;
+
+static uint64_t _hashData(const string &data)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : data) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+static uint32_t _blockHash(const char *data)
+{
+  uint32_t hash = 0;
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    hash = hash * kHashBase + (unsigned char)data[i];
+  }
+  return hash;
+}
+
+static void _putInt(string &data, uint32_t value)
+{
+  data.append((const char *)&value, sizeof(value));
+}
+
+static void _putLong(string &data, uint64_t value)
+{
+  data.append((const char *)&value, sizeof(value));
+}
+
+// hashes of the block aligned windows of old[begin, end), first occurrence wins
+static void _indexBlocks(const string &old, size_t begin, size_t end, BlockIndex &index)
+{
+  index.reserve((end - begin) / kBlockSize + 1);
+  for (size_t position = begin; position + kBlockSize <= end; position += kBlockSize) {
+    index.emplace(_blockHash(old.data() + position), (uint32_t)position);
+  }
+}
+
+static void _addInsert(PatchSection &section, const string &newData, size_t begin, size_t end)
+{
+  if (end <= begin) {
+    return;
+  }
+  section.operations += 'i';
+  _putInt(section.operations, (uint32_t)(end - begin));
+  section.operations.append(newData, begin, end - begin);
+  section.insertedBytes += end - begin;
+}
+
+static void _addCopy(PatchSection &section, size_t offset, size_t length)
+{
+  section.operations += 'c';
+  _putInt(section.operations, (uint32_t)offset);
+  _putInt(section.operations, (uint32_t)length);
+  section.copiedBytes += length;
+}
+
+// rolls a kBlockSize window over the new section and turns every window found
+// in the old range into a copy, grown in both directions as far as bytes agree
+static void _matchSection(const string &oldData, const string &newData, const BlockIndex &index, PatchSection &section)
+{
+  const char *oldBytes = oldData.data();
+  const char *newBytes = newData.data();
+  uint32_t highPower = 1;
+  for (size_t i = 1; i < kBlockSize; ++i) {
+    highPower *= kHashBase;
+  }
+  size_t position = section.newBegin;
+  size_t literalStart = position;
+  uint32_t hash = position + kBlockSize <= section.newEnd ? _blockHash(newBytes + position) : 0;
+  while (position + kBlockSize <= section.newEnd) {
+    auto found = index.find(hash);
+    if (found != index.end() && found->second >= section.oldBegin && found->second + kBlockSize <= section.oldEnd &&
+        memcmp(oldBytes + found->second, newBytes + position, kBlockSize) == 0) {
+      size_t oldPosition = found->second;
+      while (position > literalStart && oldPosition > section.oldBegin && oldBytes[oldPosition - 1] == newBytes[position - 1]) {
+        --position;
+        --oldPosition;
+      }
+      size_t length = kBlockSize + (found->second - oldPosition);
+      while (position + length < section.newEnd && oldPosition + length < section.oldEnd &&
+             oldBytes[oldPosition + length] == newBytes[position + length]) {
+        ++length;
+      }
+      _addInsert(section, newData, literalStart, position);
+      _addCopy(section, oldPosition, length);
+      position += length;
+      literalStart = position;
+      if (position + kBlockSize <= section.newEnd) {
+        hash = _blockHash(newBytes + position);
+      }
+      continue;
+    }
+    if (position + kBlockSize < section.newEnd) {
+      hash = (hash - (unsigned char)newBytes[position] * highPower) * kHashBase + (unsigned char)newBytes[position + kBlockSize];
+    }
+    ++position;
+  }
+  _addInsert(section, newData, literalStart, section.newEnd);
+}
+
+static vector<PatchSection> _makeSections(const string &oldData, const string &newData, bool &aligned)
+{
+  vector<PatchSection> sections;
+  vector<GameDataTable> oldTables;
+  vector<GameDataTable> newTables;
+  aligned = readGameDataIndex(oldData, oldTables) && readGameDataIndex(newData, newTables);
+  size_t newEnd = newData.size();
+  if (aligned) {
+    unordered_map<string, const GameDataTable *> oldByName;
+    for (const GameDataTable &table : oldTables) {
+      oldByName[table.name] = &table;
+    }
+    size_t position = 0;
+    for (const GameDataTable &table : newTables) {
+      PatchSection section;
+      section.newBegin = table.offset;
+      section.newEnd = table.offset + table.size;
+      auto old = oldByName.find(table.name);
+      // tables that are new in this version can still share bytes with any old table
+      section.oldBegin = old != oldByName.end() ? old->second->offset : 0;
+      section.oldEnd = old != oldByName.end() ? old->second->offset + old->second->size : oldData.size();
+      if (section.newBegin != position) {
+        aligned = false;
+        break;
+      }
+      position = section.newEnd;
+      sections.push_back(section);
+    }
+    if (aligned) {
+      // the index itself is matched like a table against the old index
+      PatchSection section;
+      section.newBegin = position;
+      section.newEnd = newEnd;
+      section.oldBegin = oldTables.size() > 0 ? oldTables.back().offset + oldTables.back().size : 0;
+      section.oldEnd = oldData.size();
+      sections.push_back(section);
+      return sections;
+    }
+    sections.clear();
+  }
+  for (size_t position = 0; position < newEnd || sections.empty(); position += kChunkSize) {
+    PatchSection section;
+    section.newBegin = position;
+    section.newEnd = min(newEnd, position + kChunkSize);
+    section.oldBegin = 0;
+    section.oldEnd = oldData.size();
+    sections.push_back(section);
+  }
+  return sections;
+}
+
+string createGameDataPatch(const string &oldData, const string &newData, PatchStats &stats)
+{
+  vector<PatchSection> sections = _makeSections(oldData, newData, stats.aligned);
+  stats.sections = sections.size();
+  BlockIndex wholeIndex;
+  once_flag wholeIndexFlag;
+  atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < sections.size(); i = next++) {
+      PatchSection &section = sections[i];
+      // most tables and chunks are unchanged, those need neither an index nor a scan
+      size_t length = section.newEnd - section.newBegin;
+      size_t oldPosition = stats.aligned ? section.oldBegin : section.newBegin;
+      bool sameSize = !stats.aligned || section.oldEnd - section.oldBegin == length;
+      if (length > 0 && sameSize && oldPosition + length <= section.oldEnd &&
+          memcmp(oldData.data() + oldPosition, newData.data() + section.newBegin, length) == 0) {
+        _addCopy(section, oldPosition, length);
+      } else if (stats.aligned) {
+        BlockIndex index;
+        _indexBlocks(oldData, section.oldBegin, section.oldEnd, index);
+        _matchSection(oldData, newData, index, section);
+      } else {
+        call_once(wholeIndexFlag, [&]() { _indexBlocks(oldData, 0, oldData.size(), wholeIndex); });
+        _matchSection(oldData, newData, wholeIndex, section);
+      }
+    }
+  };
+  size_t threadCount = min<size_t>(max(1u, thread::hardware_concurrency()), sections.size());
+  vector<thread> threads;
+  for (size_t i = 1; i < threadCount; ++i) {
+    threads.push_back(thread(worker));
+  }
+  worker();
+  for (thread &t : threads) {
+    t.join();
+  }
+
+  string patch(kPatchMagic, 4);
+  _putInt(patch, kPatchVersion);
+  _putInt(patch, (uint32_t)oldData.size());
+  _putLong(patch, _hashData(oldData));
+  _putInt(patch, (uint32_t)newData.size());
+  _putLong(patch, _hashData(newData));
+  for (PatchSection &section : sections) {
+    patch += section.operations;
+    stats.copiedBytes += section.copiedBytes;
+    stats.insertedBytes += section.insertedBytes;
+  }
+  patch += 'e';
+  return patch;
+}
+
+static bool _readInt(const string &data, size_t &position, uint32_t &value)
+{
+  if (position + sizeof(value) > data.size()) {
+    return false;
+  }
+  memcpy(&value, data.data() + position, sizeof(value));
+  position += sizeof(value);
+  return true;
+}
+
+static bool _readLong(const string &data, size_t &position, uint64_t &value)
+{
+  if (position + sizeof(value) > data.size()) {
+    return false;
+  }
+  memcpy(&value, data.data() + position, sizeof(value));
+  position += sizeof(value);
+  return true;
+}
+
+bool applyGameDataPatch(const string &oldData, const string &patch, string &newData, string &error)
+{
+  newData.clear();
+  size_t position = 4;
+  uint32_t version, oldSize, newSize;
+  uint64_t oldHash, newHash;
+  if (patch.compare(0, 4, kPatchMagic) != 0 || !_readInt(patch, position, version) ||
+      !_readInt(patch, position, oldSize) || !_readLong(patch, position, oldHash) ||
+      !_readInt(patch, position, newSize) || !_readLong(patch, position, newHash)) {
+    error = "not a game.dat patch";
+    return false;
+  }
+  if (version != kPatchVersion) {
+    error = "unsupported patch version " + to_string(version);
+    return false;
+  }
+  if (oldSize != oldData.size() || oldHash != _hashData(oldData)) {
+    error = "patch was made for a different game.dat";
+    return false;
+  }
+  newData.reserve(newSize);
+  while (position < patch.size()) {
+    char operation = patch[position++];
+    uint32_t offset, length;
+    if (operation == 'e') {
+      if (newData.size() != newSize || _hashData(newData) != newHash) {
+        error = "patched data doesn't match the expected result";
+        return false;
+      }
+      return true;
+    } else if (operation == 'c' && _readInt(patch, position, offset) && _readInt(patch, position, length) &&
+               (uint64_t)offset + length <= oldData.size()) {
+      newData.append(oldData, offset, length);
+    } else if (operation == 'i' && _readInt(patch, position, length) && position + length <= patch.size()) {
+      newData.append(patch, position, length);
+      position += length;
+    } else {
+      break;
+    }
+    if (newData.size() > newSize) {
+      break;
+    }
+  }
+  error = "patch is truncated or damaged";
+  return false;
+}
+
+static bool _writeFile(const string &path, const string &content)
+{
+  ofstream outfile(path, ofstream::binary);
+  outfile.write(content.data(), content.size());
+  return (bool)outfile;
+}
+
+int runPatchCommand(const string &command, const string &first, const string &second, const string &output)
+{
+  string firstData, secondData;
+  if (!readFileContent(first, firstData)) {
+    cerr << "can't read " << first << endl;
+    return 1;
+  }
+  if (!readFileContent(second, secondData)) {
+    cerr << "can't read " << second << endl;
+    return 1;
+  }
+  auto start = chrono::steady_clock::now();
+  string result;
+  if (command == "--make-patch") {
+    PatchStats stats;
+    result = createGameDataPatch(firstData, secondData, stats);
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+    cout << "patch " << result.size() << " bytes, " << stats.copiedBytes << " copied, " << stats.insertedBytes
+         << " inserted, " << stats.sections << (stats.aligned ? " tables" : " chunks") << " in " << elapsed.count() << " ms" << endl;
+  } else {
+    string error;
+    if (!applyGameDataPatch(firstData, secondData, result, error)) {
+      cerr << second << ": " << error << endl;
+      return 1;
+    }
+    cout << "patched " << result.size() << " bytes" << endl;
+  }
+  if (!_writeFile(output, result)) {
+    cerr << "can't write " << output << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,41 @@
+//
+//  GameDataPatch.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef GameDataPatch_hpp
+#define GameDataPatch_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+
+using namespace std;
+
+// Binary patch turning one game.dat into the next. When both files carry a
+// table index every table is matched against its old version only, on its
+// own thread; otherwise the new file is cut into chunks that are matched
+// against the whole old file. Layout, all integers little endian:
+//   "CSVP", uint32 version, uint32 old size, uint64 old hash,
+//   uint32 new size, uint64 new hash, then operations until 'e':
+//   'c' uint32 old offset, uint32 length   copy bytes of the old file
+//   'i' uint32 length, bytes               insert literal bytes
+struct PatchStats
+{
+  size_t copiedBytes = 0;
+  size_t insertedBytes = 0;
+  size_t sections = 0;
+  bool aligned = false;
+};
+
+string createGameDataPatch(const string &oldData, const string &newData, PatchStats &stats);
+// false and a message in error when the patch is damaged or made for another file
+bool applyGameDataPatch(const string &oldData, const string &patch, string &newData, string &error);
+
+// --make-patch and --apply-patch, returns the process exit code
+int runPatchCommand(const string &command, const string &first, const string &second, const string &output);
+
+#endif /* GameDataPatch_hpp */
@@ -0,0 +1,801 @@
+//
+//  GameDataQuery.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "GameDataQuery.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <thread>
+#include "BuildOptions.hpp"
+#include "Crc32c.hpp"
+#include "GameDataIndex.hpp"
+#include "ReadCSVFile.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define QUERY_AVX2 1
+static bool _hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+// rows per unit of work, a multiple of 64 so threads never share a selection word
+static const size_t kChunkWords = 1024;
+
+struct QueryToken
+{
+  string text;
+  bool quoted;
+};
+
+static bool _tokenize(const string &text, vector<QueryToken> &tokens, string &error)
+{
+  static const char *symbols = ",()=<>!*";
+  size_t position = 0;
+  while (position < text.size()) {
+    char c = text[position];
+    if (isspace((unsigned char)c)) {
+      position++;
+    } else if (c == '\'' || c == '"') {
+      size_t end = text.find(c, position + 1);
+      if (end == string::npos) {
+        error = "unterminated string at " + to_string(position);
+        return false;
+      }
+      tokens.push_back({text.substr(position + 1, end - position - 1), true});
+      position = end + 1;
+    } else if (strchr(symbols, c) != nullptr) {
+      size_t length = 1;
+      if ((c == '<' || c == '>' || c == '!') && position + 1 < text.size() && text[position + 1] == '=') {
+        length = 2;
+      } else if (c == '<' && position + 1 < text.size() && text[position + 1] == '>') {
+        length = 2;
+      }
+      tokens.push_back({text.substr(position, length), false});
+      position += length;
+    } else {
+      size_t end = position;
+      while (end < text.size() && !isspace((unsigned char)text[end]) && strchr(symbols, text[end]) == nullptr &&
+             text[end] != '\'' && text[end] != '"') {
+        end++;
+      }
+      tokens.push_back({text.substr(position, end - position), false});
+      position = end;
+    }
+  }
+  return true;
+}
+
+static string _lowercase(string text)
+{
+  transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return tolower(c); });
+  return text;
+}
+
+// walks the tokens of one query, every expectation that fails sets error
+class QueryParser
+{
+private:
+  const vector<QueryToken> &_tokens;
+  size_t _position = 0;
+  string &_error;
+public:
+  QueryParser(const vector<QueryToken> &tokens, string &error) : _tokens(tokens), _error(error) {}
+
+  bool atEnd() const { return _position >= _tokens.size(); }
+  bool peekKeyword(const string &keyword) const {
+    return !atEnd() && !_tokens[_position].quoted && _lowercase(_tokens[_position].text) == keyword;
+  }
+  bool acceptKeyword(const string &keyword) {
+    if (peekKeyword(keyword)) {
+      _position++;
+      return true;
+    }
+    return false;
+  }
+  bool expectKeyword(const string &keyword) {
+    if (!acceptKeyword(keyword)) {
+      _error = "expected '" + keyword + "'" + (atEnd() ? " at the end" : " before '" + _tokens[_position].text + "'");
+      return false;
+    }
+    return true;
+  }
+  bool expectEnd() {
+    if (!atEnd()) {
+      _error = "unexpected '" + _tokens[_position].text + "'";
+      return false;
+    }
+    return true;
+  }
+  bool word(string &text, const string &what) {
+    if (atEnd() || (!_tokens[_position].quoted && strchr(",()=<>!", _tokens[_position].text[0]) != nullptr)) {
+      _error = "expected " + what + (atEnd() ? " at the end" : " before '" + _tokens[_position].text + "'");
+      return false;
+    }
+    text = _tokens[_position++].text;
+    return true;
+  }
+};
+
+static bool _parseItem(QueryParser &parser, QueryItem &item, string &error)
+{
+  static const map<string, QueryAggregate> aggregates({{"count", CountAggregate}, {"sum", SumAggregate},
+    {"min", MinAggregate}, {"max", MaxAggregate}, {"avg", AverageAggregate}});
+  if (parser.acceptKeyword("*")) {
+    item.column = "*";
+    return true;
+  }
+  string name;
+  if (!parser.word(name, "a column")) {
+    return false;
+  }
+  if (!parser.acceptKeyword("(")) {
+    item.column = name;
+    return true;
+  }
+  auto aggregate = aggregates.find(_lowercase(name));
+  if (aggregate == aggregates.end()) {
+    error = "unknown aggregate '" + name + "'";
+    return false;
+  }
+  item.aggregate = aggregate->second;
+  if (parser.acceptKeyword("*")) {
+    item.column = "*";
+  } else if (!parser.word(item.column, "a column")) {
+    return false;
+  }
+  if (item.column == "*" && item.aggregate != CountAggregate) {
+    error = name + "(*) needs a column";
+    return false;
+  }
+  return parser.expectKeyword(")");
+}
+
+bool parseQuery(const string &text, Query &query, string &error)
+{
+  static const map<string, QueryCompare> compares({{"=", CompareEqual}, {"!=", CompareNotEqual}, {"<>", CompareNotEqual},
+    {"<", CompareLess}, {"<=", CompareLessEqual}, {">", CompareGreater}, {">=", CompareGreaterEqual}});
+  vector<QueryToken> tokens;
+  if (!_tokenize(text, tokens, error)) {
+    return false;
+  }
+  QueryParser parser(tokens, error);
+  if (!parser.expectKeyword("select")) {
+    return false;
+  }
+  do {
+    QueryItem item;
+    if (!_parseItem(parser, item, error)) {
+      return false;
+    }
+    query.items.push_back(item);
+  } while (parser.acceptKeyword(","));
+  if (!parser.expectKeyword("from") || !parser.word(query.table, "a table")) {
+    return false;
+  }
+  if (parser.acceptKeyword("where")) {
+    do {
+      QueryCondition condition;
+      string compare;
+      if (!parser.word(condition.column, "a column")) {
+        return false;
+      }
+      for (auto &known : compares) {
+        if (parser.acceptKeyword(known.first)) {
+          compare = known.first;
+          condition.compare = known.second;
+          break;
+        }
+      }
+      if (compare.empty()) {
+        error = "expected a comparison after '" + condition.column + "'";
+        return false;
+      }
+      if (!parser.word(condition.value, "a value")) {
+        return false;
+      }
+      query.conditions.push_back(condition);
+    } while (parser.acceptKeyword("and"));
+  }
+  if (parser.acceptKeyword("group") && (!parser.expectKeyword("by") || !parser.word(query.groupBy, "a column"))) {
+    return false;
+  }
+  if (parser.acceptKeyword("limit")) {
+    string limit;
+    char *end = nullptr;
+    if (!parser.word(limit, "a row count")) {
+      return false;
+    }
+    query.limit = strtoll(limit.c_str(), &end, 10);
+    if (*end != '\0' || query.limit < 0) {
+      error = "'" + limit + "' is not a row count";
+      return false;
+    }
+  }
+  return parser.expectEnd();
+}
+
+template <typename T>
+static bool _matches(T value, QueryCompare compare, T constant)
+{
+  switch (compare) {
+    case CompareEqual: return value == constant;
+    case CompareNotEqual: return value != constant;
+    case CompareLess: return value < constant;
+    case CompareLessEqual: return value <= constant;
+    case CompareGreater: return value > constant;
+    case CompareGreaterEqual: return value >= constant;
+  }
+  return false;
+}
+
+// strings compare bytewise, the order StringRef sorts in
+static bool _matches(StringRef value, QueryCompare compare, StringRef constant)
+{
+  switch (compare) {
+    case CompareEqual: return value == constant;
+    case CompareNotEqual: return value != constant;
+    case CompareLess: return value < constant;
+    case CompareLessEqual: return !(constant < value);
+    case CompareGreater: return constant < value;
+    case CompareGreaterEqual: return !(value < constant);
+  }
+  return false;
+}
+
+template <typename T>
+static uint64_t _compareScalar(const T *values, size_t count, QueryCompare compare, T constant)
+{
+  uint64_t bits = 0;
+  for (size_t i = 0; i < count; ++i) {
+    bits |= (uint64_t)_matches(values[i], compare, constant) << i;
+  }
+  return bits;
+}
+
+#if QUERY_AVX2
+// the integer kernels only have greater and equal, the other three are their complement
+static bool _isComplement(QueryCompare compare)
+{
+  return compare == CompareNotEqual || compare == CompareLessEqual || compare == CompareGreaterEqual;
+}
+
+__attribute__((target("avx2")))
+static uint64_t _compareInt32AVX2(const int32_t *values, QueryCompare compare, int32_t constant)
+{
+  __m256i broadcast = _mm256_set1_epi32(constant);
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i) {
+    __m256i value = _mm256_loadu_si256((const __m256i *)(values + i * 8));
+    __m256i mask;
+    if (compare == CompareGreater || compare == CompareLessEqual) {
+      mask = _mm256_cmpgt_epi32(value, broadcast);
+    } else if (compare == CompareLess || compare == CompareGreaterEqual) {
+      mask = _mm256_cmpgt_epi32(broadcast, value);
+    } else {
+      mask = _mm256_cmpeq_epi32(value, broadcast);
+    }
+    bits |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(mask)) << (i * 8);
+  }
+  return _isComplement(compare) ? ~bits : bits;
+}
+
+__attribute__((target("avx2")))
+static uint64_t _compareInt64AVX2(const int64_t *values, QueryCompare compare, int64_t constant)
+{
+  __m256i broadcast = _mm256_set1_epi64x(constant);
+  uint64_t bits = 0;
+  for (int i = 0; i < 16; ++i) {
+    __m256i value = _mm256_loadu_si256((const __m256i *)(values + i * 4));
+    __m256i mask;
+    if (compare == CompareGreater || compare == CompareLessEqual) {
+      mask = _mm256_cmpgt_epi64(value, broadcast);
+    } else if (compare == CompareLess || compare == CompareGreaterEqual) {
+      mask = _mm256_cmpgt_epi64(broadcast, value);
+    } else {
+      mask = _mm256_cmpeq_epi64(value, broadcast);
+    }
+    bits |= (uint64_t)(uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(mask)) << (i * 4);
+  }
+  return _isComplement(compare) ? ~bits : bits;
+}
+
+template <int Predicate>
+__attribute__((target("avx2")))
+static uint64_t _compareDoubleAVX2(const double *values, double constant)
+{
+  __m256d broadcast = _mm256_set1_pd(constant);
+  uint64_t bits = 0;
+  for (int i = 0; i < 16; ++i) {
+    __m256d mask = _mm256_cmp_pd(_mm256_loadu_pd(values + i * 4), broadcast, Predicate);
+    bits |= (uint64_t)(uint32_t)_mm256_movemask_pd(mask) << (i * 4);
+  }
+  return bits;
+}
+
+static uint64_t _compareDoubleAVX2(const double *values, QueryCompare compare, double constant)
+{
+  switch (compare) {
+    case CompareEqual: return _compareDoubleAVX2<_CMP_EQ_OQ>(values, constant);
+    case CompareNotEqual: return _compareDoubleAVX2<_CMP_NEQ_UQ>(values, constant);
+    case CompareLess: return _compareDoubleAVX2<_CMP_LT_OQ>(values, constant);
+    case CompareLessEqual: return _compareDoubleAVX2<_CMP_LE_OQ>(values, constant);
+    case CompareGreater: return _compareDoubleAVX2<_CMP_GT_OQ>(values, constant);
+    case CompareGreaterEqual: return _compareDoubleAVX2<_CMP_GE_OQ>(values, constant);
+  }
+  return 0;
+}
+#endif
+
+static uint64_t _compareWord(const int32_t *values, size_t count, QueryCompare compare, int32_t constant)
+{
+#if QUERY_AVX2
+  if (_hasAVX2 && count == 64) {
+    return _compareInt32AVX2(values, compare, constant);
+  }
+#endif
+  return _compareScalar(values, count, compare, constant);
+}
+
+static uint64_t _compareWord(const int64_t *values, size_t count, QueryCompare compare, int64_t constant)
+{
+#if QUERY_AVX2
+  if (_hasAVX2 && count == 64) {
+    return _compareInt64AVX2(values, compare, constant);
+  }
+#endif
+  return _compareScalar(values, count, compare, constant);
+}
+
+static uint64_t _compareWord(const double *values, size_t count, QueryCompare compare, double constant)
+{
+#if QUERY_AVX2
+  if (_hasAVX2 && count == 64) {
+    return _compareDoubleAVX2(values, compare, constant);
+  }
+#endif
+  return _compareScalar(values, count, compare, constant);
+}
+
+static uint64_t _compareWord(const StringRef *values, size_t count, QueryCompare compare, StringRef constant)
+{
+  return _compareScalar(values, count, compare, constant);
+}
+
+// a condition with its column and constant looked up once
+struct BoundCondition
+{
+  const DataColumn *column;
+  QueryCompare compare;
+  int64_t integer = 0;
+  double number = 0;
+  StringRef text;
+};
+
+static bool _bindCondition(const DataTable &table, const QueryCondition &condition, BoundCondition &bound, string &error)
+{
+  bound.column = table.column(condition.column);
+  bound.compare = condition.compare;
+  if (bound.column == nullptr) {
+    error = "no column '" + condition.column + "' in " + table.name();
+    return false;
+  }
+  const char *value = condition.value.c_str();
+  char *end = nullptr;
+  switch (bound.column->encoding()) {
+    case Int32Encoding:
+    case Int64Encoding:
+      bound.integer = strtoll(value, &end, 10);
+      if (*value == '\0' || *end != '\0' ||
+          (bound.column->encoding() == Int32Encoding && (bound.integer < INT32_MIN || bound.integer > INT32_MAX))) {
+        error = "'" + condition.value + "' is not a valid " + bound.column->type() + " for " + condition.column;
+        return false;
+      }
+      return true;
+    case DoubleEncoding:
+      bound.number = strtod(value, &end);
+      if (*value == '\0' || *end != '\0') {
+        error = "'" + condition.value + "' is not a valid double for " + condition.column;
+        return false;
+      }
+      return true;
+    case StringEncoding:
+      bound.text = StringRef(condition.value.data(), condition.value.size());
+      return true;
+    default:
+      error = condition.column + " is a " + bound.column->type() + ", sets and arrays can't be compared";
+      return false;
+  }
+}
+
+template <typename T>
+static void _applyCondition(const T *values, size_t rowCount, QueryCompare compare, T constant,
+                            size_t wordBegin, size_t wordEnd, uint64_t *selection)
+{
+  for (size_t word = wordBegin; word < wordEnd; ++word) {
+    // rows an earlier condition already dropped aren't compared again
+    if (selection[word] != 0) {
+      size_t row = word * 64;
+      selection[word] &= _compareWord(values + row, min<size_t>(64, rowCount - row), compare, constant);
+    }
+  }
+}
+
+bool filterTable(const DataTable &table, const vector<QueryCondition> &conditions,
+                 vector<uint64_t> &selection, string &error, unsigned threads)
+{
+  vector<BoundCondition> bound(conditions.size());
+  for (size_t i = 0; i < conditions.size(); ++i) {
+    if (!_bindCondition(table, conditions[i], bound[i], error)) {
+      return false;
+    }
+  }
+  size_t rowCount = table.rowCount();
+  size_t words = (rowCount + 63) / 64;
+  selection.assign(words, ~0ULL);
+  if (rowCount % 64 != 0) {
+    selection.back() = (1ULL << (rowCount % 64)) - 1;
+  }
+  atomic<size_t> next(0);
+  size_t chunks = (words + kChunkWords - 1) / kChunkWords;
+  auto worker = [&]() {
+    for (size_t chunk = next++; chunk < chunks; chunk = next++) {
+      size_t wordBegin = chunk * kChunkWords;
+      size_t wordEnd = min(words, wordBegin + kChunkWords);
+      for (const BoundCondition &condition : bound) {
+        const DataColumn &column = *condition.column;
+        switch (column.encoding()) {
+          case Int32Encoding:
+            _applyCondition(column.int32Values().data(), rowCount, condition.compare, (int32_t)condition.integer, wordBegin, wordEnd, selection.data());
+            break;
+          case Int64Encoding:
+            _applyCondition(column.int64Values().data(), rowCount, condition.compare, condition.integer, wordBegin, wordEnd, selection.data());
+            break;
+          case DoubleEncoding:
+            _applyCondition(column.doubleValues().data(), rowCount, condition.compare, condition.number, wordBegin, wordEnd, selection.data());
+            break;
+          default:
+            _applyCondition(column.stringValues().data(), rowCount, condition.compare, condition.text, wordBegin, wordEnd, selection.data());
+            break;
+        }
+      }
+    }
+  };
+  size_t threadCount = threads > 0 ? threads : max(1u, thread::hardware_concurrency());
+  threadCount = min(threadCount, max<size_t>(1, chunks));
+  vector<thread> workers;
+  for (size_t i = 1; i < threadCount; ++i) {
+    workers.push_back(thread(worker));
+  }
+  worker();
+  for (thread &t : workers) {
+    t.join();
+  }
+  return true;
+}
+
+static string _formatNumber(double value)
+{
+  char text[32];
+  snprintf(text, sizeof(text), "%.15g", value);
+  return text;
+}
+
+static void _appendCell(string &line, const DataColumn &column, size_t row)
+{
+  string cell;
+  switch (column.encoding()) {
+    case Int32Encoding: cell = to_string(column.int32At(row)); break;
+    case Int64Encoding: cell = to_string(column.int64At(row)); break;
+    case DoubleEncoding: cell = _formatNumber(column.doubleAt(row)); break;
+    case StringEncoding: cell = column.stringAt(row).str(); break;
+    default:
+      for (size_t i = 0; i < column.listSize(row); ++i) {
+        cell += i > 0 ? ";" : "";
+        if (column.encoding() == StringListEncoding) {
+          cell += column.stringList(row)[i].str();
+        } else if (column.encoding() == Int32ListEncoding) {
+          cell += to_string(column.int32List(row)[i]);
+        } else if (column.encoding() == Int64ListEncoding) {
+          cell += to_string(column.int64List(row)[i]);
+        } else {
+          cell += _formatNumber(column.doubleList(row)[i]);
+        }
+      }
+  }
+  // quoted the way spreadsheets expect when the cell would split the line
+  if (cell.find_first_of(",\"\r\n") != string::npos) {
+    string quoted = "\"";
+    for (char c : cell) {
+      quoted += c == '"' ? "\"\"" : string(1, c);
+    }
+    cell = quoted + "\"";
+  }
+  line += cell;
+}
+
+// running count, sum, min and max of one aggregate item in one group
+struct Accumulator
+{
+  uint64_t count = 0;
+  double sum = 0;
+  int64_t integerSum = 0;
+  double min = 0;
+  double max = 0;
+
+  void add(double value, int64_t integer) {
+    min = count == 0 || value < min ? value : min;
+    max = count == 0 || value > max ? value : max;
+    sum += value;
+    integerSum += integer;
+    count++;
+  }
+  void merge(const Accumulator &other) {
+    if (other.count > 0) {
+      min = count == 0 || other.min < min ? other.min : min;
+      max = count == 0 || other.max > max ? other.max : max;
+    }
+    sum += other.sum;
+    integerSum += other.integerSum;
+    count += other.count;
+  }
+};
+
+typedef map<string, vector<Accumulator>> AggregateGroups;
+
+static bool _aggregate(const DataTable &table, const Query &query, const vector<uint64_t> &selection, string &error)
+{
+  vector<const DataColumn *> columns;
+  for (const QueryItem &item : query.items) {
+    const DataColumn *column = item.column == "*" ? nullptr : table.column(item.column);
+    if (item.column != "*" && column == nullptr) {
+      error = "no column '" + item.column + "' in " + table.name();
+      return false;
+    }
+    if (item.aggregate == NoAggregate && item.column != query.groupBy) {
+      error = item.column + " has to be aggregated or be the group by column";
+      return false;
+    }
+    if (item.aggregate > CountAggregate && !column->isNumeric()) {
+      error = item.column + " is a " + column->type() + ", only numbers can be summed";
+      return false;
+    }
+    columns.push_back(column);
+  }
+  const DataColumn *groupColumn = nullptr;
+  if (!query.groupBy.empty() && (groupColumn = table.column(query.groupBy)) == nullptr) {
+    error = "no column '" + query.groupBy + "' in " + table.name();
+    return false;
+  }
+
+  size_t words = selection.size();
+  size_t chunks = (words + kChunkWords - 1) / kChunkWords;
+  size_t threadCount = min<size_t>(max(1u, thread::hardware_concurrency()), max<size_t>(1, chunks));
+  vector<AggregateGroups> partials(threadCount);
+  atomic<size_t> next(0);
+  auto worker = [&](AggregateGroups &groups) {
+    string key;
+    for (size_t chunk = next++; chunk < chunks; chunk = next++) {
+      size_t wordEnd = min(words, (chunk + 1) * kChunkWords);
+      for (size_t word = chunk * kChunkWords; word < wordEnd; ++word) {
+        for (uint64_t bits = selection[word]; bits != 0; bits &= bits - 1) {
+          size_t row = word * 64 + __builtin_ctzll(bits);
+          key.clear();
+          if (groupColumn != nullptr) {
+            _appendCell(key, *groupColumn, row);
+          }
+          vector<Accumulator> &accumulators = groups[key];
+          accumulators.resize(columns.size());
+          for (size_t i = 0; i < columns.size(); ++i) {
+            const DataColumn *column = columns[i];
+            bool isNumber = column != nullptr && column->isNumeric();
+            accumulators[i].add(isNumber ? column->numberAt(row) : 0, isNumber ? column->integerAt(row) : 0);
+          }
+        }
+      }
+    }
+  };
+  vector<thread> workers;
+  for (size_t i = 1; i < threadCount; ++i) {
+    workers.push_back(thread(worker, ref(partials[i])));
+  }
+  worker(partials[0]);
+  for (thread &t : workers) {
+    t.join();
+  }
+  AggregateGroups &groups = partials[0];
+  for (size_t i = 1; i < partials.size(); ++i) {
+    for (auto &group : partials[i]) {
+      vector<Accumulator> &accumulators = groups[group.first];
+      accumulators.resize(columns.size());
+      for (size_t item = 0; item < columns.size(); ++item) {
+        accumulators[item].merge(group.second[item]);
+      }
+    }
+  }
+  // an aggregate over no rows still answers, with a count of 0
+  if (groups.empty() && groupColumn == nullptr) {
+    groups[""].resize(columns.size());
+  }
+
+  static const char *names[] = {"", "count", "sum", "min", "max", "avg"};
+  string line;
+  for (size_t i = 0; i < query.items.size(); ++i) {
+    const QueryItem &item = query.items[i];
+    line += (i > 0 ? "," : "") + (item.aggregate == NoAggregate ? item.column : string(names[item.aggregate]) + "(" + item.column + ")");
+  }
+  cout << line << "\n";
+  // the map keeps the keys in text order, a number column comes out by value
+  struct OrderedGroup
+  {
+    const AggregateGroups::value_type *group;
+    int64_t integer;
+    double number;
+  };
+  vector<OrderedGroup> ordered;
+  for (const auto &group : groups) {
+    ordered.push_back({&group, strtoll(group.first.c_str(), nullptr, 10), strtod(group.first.c_str(), nullptr)});
+  }
+  if (groupColumn != nullptr && groupColumn->isNumeric()) {
+    bool isInteger = groupColumn->encoding() != DoubleEncoding;
+    stable_sort(ordered.begin(), ordered.end(), [isInteger](const OrderedGroup &a, const OrderedGroup &b) {
+      return isInteger ? a.integer < b.integer : a.number < b.number;
+    });
+  }
+  int64_t printed = 0;
+  for (const OrderedGroup &orderedGroup : ordered) {
+    const AggregateGroups::value_type &group = *orderedGroup.group;
+    if (query.limit >= 0 && printed++ >= query.limit) {
+      break;
+    }
+    line.clear();
+    for (size_t i = 0; i < query.items.size(); ++i) {
+      const Accumulator &accumulator = group.second[i];
+      const DataColumn *column = columns[i];
+      bool isInteger = column != nullptr && column->encoding() != DoubleEncoding;
+      line += i > 0 ? "," : "";
+      switch (query.items[i].aggregate) {
+        case NoAggregate: line += group.first; break;
+        case CountAggregate: line += to_string(accumulator.count); break;
+        case SumAggregate: line += isInteger ? to_string(accumulator.integerSum) : _formatNumber(accumulator.sum); break;
+        case MinAggregate: line += accumulator.count > 0 ? _formatNumber(accumulator.min) : ""; break;
+        case MaxAggregate: line += accumulator.count > 0 ? _formatNumber(accumulator.max) : ""; break;
+        case AverageAggregate: line += accumulator.count > 0 ? _formatNumber(accumulator.sum / accumulator.count) : ""; break;
+      }
+    }
+    cout << line << "\n";
+  }
+  return true;
+}
+
+static bool _project(const DataTable &table, const Query &query, const vector<uint64_t> &selection, string &error)
+{
+  vector<const DataColumn *> columns;
+  for (const QueryItem &item : query.items) {
+    if (item.column == "*") {
+      for (const DataColumn &column : table.columns()) {
+        columns.push_back(&column);
+      }
+    } else if (table.column(item.column) != nullptr) {
+      columns.push_back(table.column(item.column));
+    } else {
+      error = "no column '" + item.column + "' in " + table.name();
+      return false;
+    }
+  }
+  string line;
+  for (size_t i = 0; i < columns.size(); ++i) {
+    line += (i > 0 ? "," : "") + columns[i]->name();
+  }
+  cout << line << "\n";
+  int64_t printed = 0;
+  for (size_t word = 0; word < selection.size(); ++word) {
+    for (uint64_t bits = selection[word]; bits != 0; bits &= bits - 1) {
+      if (query.limit >= 0 && printed >= query.limit) {
+        return true;
+      }
+      size_t row = word * 64 + __builtin_ctzll(bits);
+      line.clear();
+      for (size_t i = 0; i < columns.size(); ++i) {
+        line += i > 0 ? "," : "";
+        _appendCell(line, *columns[i], row);
+      }
+      cout << line << "\n";
+      printed++;
+    }
+  }
+  return true;
+}
+
+// converts the source of one table in memory into what a build with
+// --table-index --embed-strings would write, so name_ columns can be queried too
+static bool _loadSource(const string &rootPath, const string &tableName, GameDataFile &file, string &error)
+{
+  BuildOptions options;
+  options.rootPath = rootPath;
+  if (options.rootPath.back() != '/') {
+    options.rootPath += "/";
+  }
+  options.convert.embedStrings = true;
+  string fileName = tableName + CSV_EXTENSION;
+  struct stat st;
+  bool isMatrix = stat((options.excelPath() + fileName).c_str(), &st) != 0;
+  string basePath = isMatrix ? options.matrixPath() : options.excelPath();
+  if (isMatrix && stat((basePath + fileName).c_str(), &st) != 0) {
+    error = "no " + fileName + " in " + options.excelPath() + " or " + basePath;
+    return false;
+  }
+  
+  auto segment = std::make_unique<bb::ByteBuffer>();
+  TableSchema schema;
+  ObjectiveArena arena;
+  LocalizedStringTable localizedMap;
+  Validator validator(fileName);
+  if (isMatrix) {
+    convertMatriceCSVToObjectiveClass(arena, basePath, fileName, segment, validator, &schema);
+  } else {
+    convertCSVToObjectiveClass(arena, basePath, fileName, localizedMap, segment, validator, options.convert, &schema);
+  }
+  if (validator.hasErrors()) {
+    printValidationErrors(cerr, validator.errors());
+    error = "the source has errors";
+    return false;
+  }
+  uint32_t crc = crc32c(0, segment->data(), segment->size());
+  vector<GameDataTable> index({{schema.name, 0, segment->size(), crc, encodeTableSchema(schema, options.convert)}});
+  appendGameDataIndex(*segment, index);
+  return file.load(string((const char *)segment->data(), segment->size()), error);
+}
+
+int runQueryCommand(const string &path, const string &text)
+{
+  Query query;
+  string error;
+  if (!parseQuery(text, query, error)) {
+    cerr << "query: " << error << endl;
+    return 1;
+  }
+  auto begin = chrono::steady_clock::now();
+  GameDataFile file;
+  struct stat st;
+  bool isDirectory = stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+  if (!(isDirectory ? _loadSource(path, query.table, file, error) : file.open(path, error))) {
+    cerr << path << ": " << error << endl;
+    return 1;
+  }
+  const DataTable *table = file.table(query.table, error);
+  if (table == nullptr) {
+    cerr << path << ": " << error << endl;
+    return 1;
+  }
+  auto loaded = chrono::steady_clock::now();
+  bool aggregates = !query.groupBy.empty();
+  for (const QueryItem &item : query.items) {
+    aggregates = aggregates || item.aggregate != NoAggregate;
+  }
+  vector<uint64_t> selection;
+  if (!filterTable(*table, query.conditions, selection, error) ||
+      !(aggregates ? _aggregate(*table, query, selection, error) : _project(*table, query, selection, error))) {
+    cerr << "query: " << error << endl;
+    return 1;
+  }
+  cout.flush();
+  size_t matched = 0;
+  for (uint64_t bits : selection) {
+    matched += __builtin_popcountll(bits);
+  }
+  auto done = chrono::steady_clock::now();
+  cerr << matched << " of " << table->rowCount() << " rows matched, loaded in "
+       << chrono::duration<double>(loaded - begin).count() * 1e3 << " ms, queried in "
+       << chrono::duration<double>(done - loaded).count() * 1e3 << " ms" << endl;
+  return 0;
+}
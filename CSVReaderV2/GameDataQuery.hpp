@@ -0,0 +1,65 @@
+//
+//  GameDataQuery.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef GameDataQuery_hpp
+#define GameDataQuery_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "GameDataReader.hpp"
+
+using namespace std;
+
+// Filter, project and aggregate over one decoded table:
+//   select <items> from <table> [where <condition> [and <condition>]...]
+//          [group by <column>] [limit <n>]
+// items are *, columns, count(*), sum(c), min(c), max(c) and avg(c),
+// conditions compare a column with a number or a 'quoted' or bare string
+// using = != < <= > >=. Keywords are case insensitive.
+
+enum QueryCompare { CompareEqual, CompareNotEqual, CompareLess, CompareLessEqual, CompareGreater, CompareGreaterEqual };
+
+struct QueryCondition
+{
+  string column;
+  QueryCompare compare;
+  string value;
+};
+
+enum QueryAggregate { NoAggregate, CountAggregate, SumAggregate, MinAggregate, MaxAggregate, AverageAggregate };
+
+struct QueryItem
+{
+  QueryAggregate aggregate = NoAggregate;
+  // "*" for every column or count(*)
+  string column;
+};
+
+struct Query
+{
+  vector<QueryItem> items;
+  string table;
+  vector<QueryCondition> conditions;
+  string groupBy;
+  // -1 for every matching row
+  int64_t limit = -1;
+};
+
+bool parseQuery(const string &text, Query &query, string &error);
+
+// one bit per row, set for the rows every condition holds for. Numeric
+// columns are compared 4 or 8 values at a time, the rows are split over threads.
+bool filterTable(const DataTable &table, const vector<QueryCondition> &conditions,
+                 vector<uint64_t> &selection, string &error, unsigned threads = 0);
+
+// --query, path is a game.dat built with --table-index or a project root
+// whose sources are converted in memory, returns the exit code
+int runQueryCommand(const string &path, const string &text);
+
+#endif /* GameDataQuery_hpp */
@@ -0,0 +1,538 @@
+//
+//  GameDataReader.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "GameDataReader.hpp"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "Crc32c.hpp"
+#include "GameDataIndex.hpp"
+#include "NumberPacking.hpp"
+
+// bounds checked reads over one table, a failed read sets ok and returns zeros
+struct DataCursor
+{
+  const char *data;
+  size_t length;
+  size_t position = 0;
+  bool ok = true;
+
+  DataCursor(const char *data, size_t length) : data(data), length(length) {}
+
+  bool has(uint64_t size) {
+    ok = ok && size <= length - position;
+    return ok;
+  }
+  // count items of at least itemSize bytes each, without overflowing on damaged counts
+  bool hasItems(uint64_t count, size_t itemSize) {
+    ok = ok && count <= (length - position) / itemSize;
+    return ok;
+  }
+  template <typename T> T read() {
+    T value = T();
+    if (has(sizeof(T))) {
+      memcpy(&value, data + position, sizeof(T));
+      position += sizeof(T);
+    }
+    return value;
+  }
+  StringRef readString() {
+    uint64_t size = read<uint64_t>();
+    if (!has(size)) {
+      return StringRef();
+    }
+    StringRef value(data + position, (size_t)size);
+    position += size;
+    return value;
+  }
+  // count values of T that follow, copied out since nothing in game.dat is aligned
+  template <typename T> void readValues(uint64_t count, vector<T> &values) {
+    if (!hasItems(count, sizeof(T))) {
+      return;
+    }
+    size_t start = values.size();
+    values.resize(start + (size_t)count);
+    memcpy(values.data() + start, data + position, count * sizeof(T));
+    position += count * sizeof(T);
+  }
+};
+
+bool parseTableSchema(const char *data, size_t length, DataTableSchema &schema)
+{
+  DataCursor cursor(data, length);
+  uint8_t version = cursor.read<uint8_t>();
+  schema.kind = (SchemaKind)cursor.read<uint8_t>();
+  schema.flags = cursor.read<uint8_t>();
+  if (!cursor.ok || version != kSchemaVersion || schema.kind > SchemaMatrix) {
+    return false;
+  }
+  if (schema.kind == SchemaMatrix) {
+    schema.functionName = cursor.readString().str();
+    schema.colName = cursor.readString().str();
+    schema.rowName = cursor.readString().str();
+    schema.valueType = cursor.readString().str();
+    return cursor.ok && cursor.position == length;
+  }
+  schema.key = cursor.readString().str();
+  uint32_t columnCount = cursor.read<uint32_t>();
+  for (uint32_t i = 0; i < columnCount && cursor.ok; ++i) {
+    DataColumnSchema column;
+    column.name = cursor.readString().str();
+    column.type = cursor.readString().str();
+    column.encoding = (ColumnEncoding)cursor.read<uint8_t>();
+    if (column.encoding < Int32Encoding || column.encoding > DoubleListEncoding) {
+      return false;
+    }
+    schema.columns.push_back(column);
+  }
+  uint32_t embeddedCount = cursor.read<uint32_t>();
+  for (uint32_t i = 0; i < embeddedCount && cursor.ok; ++i) {
+    schema.embeddedStrings.push_back(cursor.readString().str());
+  }
+  return cursor.ok && cursor.position == length;
+}
+
+int64_t DataColumn::integerAt(size_t row) const
+{
+  switch (_schema.encoding) {
+    case Int32Encoding: return _int32s[row];
+    case Int64Encoding: return _int64s[row];
+    case DoubleEncoding: return (int64_t)_doubles[row];
+    default: return 0;
+  }
+}
+
+double DataColumn::numberAt(size_t row) const
+{
+  switch (_schema.encoding) {
+    case Int32Encoding: return _int32s[row];
+    case Int64Encoding: return (double)_int64s[row];
+    case DoubleEncoding: return _doubles[row];
+    default: return 0;
+  }
+}
+
+static void _splitItems(const StringRef &cell, vector<StringRef> &items)
+{
+  const char *begin = cell.data;
+  const char *end = cell.data + cell.size;
+  for (const char *separator; (separator = (const char *)memchr(begin, ';', end - begin)) != nullptr; begin = separator + 1) {
+    items.push_back(StringRef(begin, separator - begin));
+  }
+  items.push_back(StringRef(begin, end - begin));
+}
+
+bool DataTable::_decodeRows(const char *data, size_t length, string &error)
+{
+  DataCursor cursor(data, length);
+  for (DataColumn &column : _columns) {
+    if (column.isList()) {
+      column._listOffsets.reserve(_rowCount + 1);
+      column._listOffsets.push_back(0);
+    }
+  }
+  cursor.position = sizeof(int32_t);
+  size_t stored = _schema.columns.size();
+  for (size_t row = 0; row < _rowCount && cursor.ok; ++row) {
+    for (size_t i = 0; i < stored; ++i) {
+      DataColumn &column = _columns[i];
+      uint64_t items = 0;
+      switch (column.encoding()) {
+        case Int32Encoding: column._int32s.push_back(cursor.read<int32_t>()); break;
+        case Int64Encoding: column._int64s.push_back(cursor.read<int64_t>()); break;
+        case DoubleEncoding: column._doubles.push_back(cursor.read<double>()); break;
+        case StringEncoding: column._strings.push_back(cursor.readString()); break;
+        case StringListEncoding:
+          items = cursor.read<uint64_t>();
+          // every item takes at least its length, a bigger count is damage
+          for (uint64_t item = 0; cursor.hasItems(items - item, sizeof(uint64_t)) && item < items; ++item) {
+            column._strings.push_back(cursor.readString());
+          }
+          break;
+        case Int32ListEncoding: items = cursor.read<uint64_t>(); cursor.readValues(items, column._int32s); break;
+        case Int64ListEncoding: items = cursor.read<uint64_t>(); cursor.readValues(items, column._int64s); break;
+        case DoubleListEncoding: items = cursor.read<uint64_t>(); cursor.readValues(items, column._doubles); break;
+      }
+      if (column.isList()) {
+        column._listOffsets.push_back(column._listOffsets.back() + (uint32_t)items);
+      }
+    }
+  }
+  for (size_t i = stored; i < _columns.size() && cursor.ok; ++i) {
+    for (size_t row = 0; row < _rowCount && cursor.ok; ++row) {
+      _columns[i]._strings.push_back(cursor.readString());
+    }
+  }
+  if (!cursor.ok || cursor.position != length) {
+    error = _name + ": rows don't match the schema";
+    return false;
+  }
+  return true;
+}
+
+// byte offsets of the UTF-16 offsets the generated Dic uses to cut NSStrings
+static bool _byteOffsets(const StringRef &text, const vector<int32_t> &units, vector<size_t> &bytes)
+{
+  bytes.resize(units.size());
+  size_t byte = 0;
+  int32_t unit = 0;
+  for (size_t i = 0; i < units.size(); ++i) {
+    while (unit < units[i] && byte < text.size) {
+      unsigned char c = text.data[byte];
+      byte += c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+      unit += c >= 0xF0 ? 2 : 1;
+    }
+    if (unit != units[i] || byte > text.size) {
+      return false;
+    }
+    bytes[i] = byte;
+  }
+  return true;
+}
+
+bool DataTable::_decodeColumns(const char *data, size_t length, string &error)
+{
+  DataCursor cursor(data, length);
+  cursor.position = sizeof(int32_t);
+  vector<int32_t> offsets;
+  vector<size_t> bytes;
+  vector<int64_t> unpacked;
+  for (size_t i = 0; i < _schema.columns.size() && cursor.ok; ++i) {
+    DataColumn &column = _columns[i];
+    ColumnEncoding encoding = column.encoding();
+    if (_schema.packsNumbers() && isPackedNumberType(column.type())) {
+      unpacked.resize(_rowCount);
+      cursor.ok = unpackNumbers(data, length, cursor.position, _rowCount, encoding == Int64Encoding ? 8 : 4, unpacked.data());
+      if (encoding == Int64Encoding) {
+        column._int64s.assign(unpacked.begin(), unpacked.end());
+      } else {
+        column._int32s.assign(unpacked.begin(), unpacked.end());
+      }
+      continue;
+    } else if (encoding == Int32Encoding) {
+      cursor.readValues(_rowCount, column._int32s);
+      continue;
+    } else if (encoding == Int64Encoding) {
+      cursor.readValues(_rowCount, column._int64s);
+      continue;
+    } else if (encoding == DoubleEncoding) {
+      cursor.readValues(_rowCount, column._doubles);
+      continue;
+    }
+    StringRef text;
+    if (encoding == StringEncoding || encoding == StringListEncoding) {
+      text = cursor.readString();
+    }
+    offsets.clear();
+    cursor.readValues(_rowCount + 1, offsets);
+    if (!cursor.ok) {
+      break;
+    }
+    if (encoding == StringEncoding || encoding == StringListEncoding) {
+      if (!_byteOffsets(text, offsets, bytes)) {
+        cursor.ok = false;
+        break;
+      }
+      column._listOffsets.push_back(0);
+      for (size_t row = 0; row < _rowCount; ++row) {
+        StringRef cell(text.data + bytes[row], bytes[row + 1] - bytes[row]);
+        if (encoding == StringEncoding) {
+          column._strings.push_back(cell);
+        } else {
+          _splitItems(cell, column._strings);
+          column._listOffsets.push_back((uint32_t)column._strings.size());
+        }
+      }
+      if (encoding == StringEncoding) {
+        column._listOffsets.clear();
+      }
+      continue;
+    }
+    // packed lists, the offsets count elements
+    for (size_t row = 0; row < _rowCount; ++row) {
+      if (offsets[row] < 0 || offsets[row + 1] < offsets[row]) {
+        cursor.ok = false;
+      }
+    }
+    if (!cursor.ok || offsets[0] != 0) {
+      cursor.ok = false;
+      break;
+    }
+    column._listOffsets.assign(offsets.begin(), offsets.end());
+    size_t items = offsets[_rowCount];
+    if (encoding == Int32ListEncoding) {
+      cursor.readValues(items, column._int32s);
+    } else if (encoding == Int64ListEncoding) {
+      cursor.readValues(items, column._int64s);
+    } else {
+      cursor.readValues(items, column._doubles);
+    }
+  }
+  for (size_t i = _schema.columns.size(); i < _columns.size() && cursor.ok; ++i) {
+    for (size_t row = 0; row < _rowCount && cursor.ok; ++row) {
+      _columns[i]._strings.push_back(cursor.readString());
+    }
+  }
+  if (!cursor.ok || cursor.position != length) {
+    error = _name + ": columns don't match the schema";
+    return false;
+  }
+  return true;
+}
+
+bool DataTable::_decodeMatrix(const char *data, size_t length, string &error)
+{
+  DataCursor cursor(data, length);
+  vector<StringRef> colKeys;
+  uint64_t colCount = cursor.read<uint64_t>();
+  for (uint64_t i = 0; cursor.hasItems(colCount - i, sizeof(uint64_t)) && i < colCount; ++i) {
+    colKeys.push_back(cursor.readString());
+  }
+  DataColumn rowKeys;
+  rowKeys._schema = {_schema.rowName, "string", StringEncoding};
+  uint64_t rowCount = cursor.read<uint64_t>();
+  for (uint64_t i = 0; cursor.hasItems(rowCount - i, sizeof(uint64_t)) && i < rowCount; ++i) {
+    rowKeys._strings.push_back(cursor.readString());
+  }
+  _columns.push_back(move(rowKeys));
+  for (const StringRef &key : colKeys) {
+    DataColumn column;
+    column._schema = {key.str(), _schema.valueType, StringEncoding};
+    column._strings.reserve((size_t)rowCount);
+    _columns.push_back(move(column));
+  }
+  for (uint64_t row = 0; row < rowCount && cursor.ok; ++row) {
+    for (size_t col = 1; col < _columns.size(); ++col) {
+      _columns[col]._strings.push_back(cursor.readString());
+    }
+  }
+  _rowCount = (size_t)rowCount;
+  if (!cursor.ok || cursor.position != length) {
+    error = _name + ": matrix is truncated";
+    return false;
+  }
+  return true;
+}
+
+bool DataTable::_decode(const char *data, size_t length, string &error)
+{
+  if (_schema.isMatrix()) {
+    return _decodeMatrix(data, length, error);
+  }
+  int32_t rowCount = 0;
+  if (length < sizeof(rowCount) || (memcpy(&rowCount, data, sizeof(rowCount)), rowCount < 0)) {
+    error = _name + ": no row count";
+    return false;
+  }
+  // every row holds at least its key, anything more is damage
+  if ((size_t)rowCount > length) {
+    error = _name + ": row count is damaged";
+    return false;
+  }
+  _rowCount = rowCount;
+  for (const DataColumnSchema &columnSchema : _schema.columns) {
+    DataColumn column;
+    column._schema = columnSchema;
+    _columns.push_back(move(column));
+  }
+  for (const string &embedded : _schema.embeddedStrings) {
+    DataColumn column;
+    column._schema = {embedded, "name_" + embedded, StringEncoding};
+    _columns.push_back(move(column));
+  }
+  for (DataColumn &column : _columns) {
+    if (column.encoding() == StringEncoding) {
+      column._strings.reserve(_rowCount);
+    }
+  }
+  return _schema.isColumnar() ? _decodeColumns(data, length, error) : _decodeRows(data, length, error);
+}
+
+int DataTable::columnIndex(const string &name) const
+{
+  for (size_t i = 0; i < _columns.size(); ++i) {
+    if (_columns[i].name() == name) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+const DataColumn *DataTable::column(const string &name) const
+{
+  int index = columnIndex(name);
+  return index < 0 ? nullptr : &_columns[index];
+}
+
+int64_t DataTable::findRow(const StringRef &key) const
+{
+  int index = _schema.isMatrix() ? 0 : columnIndex(_schema.key);
+  if (index < 0 || _columns[index].encoding() != StringEncoding) {
+    return -1;
+  }
+  const vector<StringRef> &keys = _columns[index].stringValues();
+  for (size_t row = 0; row < keys.size(); ++row) {
+    if (keys[row] == key) {
+      return (int64_t)row;
+    }
+  }
+  return -1;
+}
+
+bool GameDataFile::open(const string &path, string &error)
+{
+  ifstream indata(path, ifstream::binary);
+  if (!indata) {
+    error = "can't read " + path;
+    return false;
+  }
+  indata.seekg(0, ios::end);
+  string data((size_t)indata.tellg(), '\0');
+  indata.seekg(0, ios::beg);
+  indata.read(&data[0], data.size());
+  return load(move(data), error);
+}
+
+bool GameDataFile::load(string data, string &error)
+{
+  _data = move(data);
+  _entries.clear();
+  _tables.clear();
+  vector<GameDataTable> index;
+  if (!readGameDataIndex(_data, index)) {
+    error = "no table index, the file is damaged or was built without --table-index";
+    return false;
+  }
+  for (GameDataTable &table : index) {
+    Entry entry;
+    entry.name = table.name;
+    entry.offset = table.offset;
+    entry.size = table.size;
+    entry.crc = table.crc;
+    if (!parseTableSchema(table.schema.data(), table.schema.size(), entry.schema)) {
+      error = table.name + ": unknown schema, the file is damaged or newer than this reader";
+      _entries.clear();
+      return false;
+    }
+    _entries.push_back(move(entry));
+  }
+  _tables.resize(_entries.size());
+  return true;
+}
+
+int GameDataFile::tableIndex(const string &name) const
+{
+  for (size_t i = 0; i < _entries.size(); ++i) {
+    if (_entries[i].name == name) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+bool GameDataFile::verify(string &error) const
+{
+  for (const Entry &entry : _entries) {
+    if (crc32c(0, _data.data() + entry.offset, entry.size) != entry.crc) {
+      error = entry.name + " is corrupted";
+      return false;
+    }
+  }
+  return true;
+}
+
+const DataTable *GameDataFile::table(size_t table, string &error)
+{
+  if (table >= _entries.size()) {
+    error = "no table " + to_string(table);
+    return nullptr;
+  }
+  if (_tables[table] == nullptr) {
+    const Entry &entry = _entries[table];
+    unique_ptr<DataTable> decoded(new DataTable());
+    decoded->_name = entry.name;
+    decoded->_schema = entry.schema;
+    if (!decoded->_decode(_data.data() + entry.offset, entry.size, error)) {
+      return nullptr;
+    }
+    _tables[table] = move(decoded);
+  }
+  return _tables[table].get();
+}
+
+const DataTable *GameDataFile::table(const string &name, string &error)
+{
+  int index = tableIndex(name);
+  if (index < 0) {
+    error = "no table " + name;
+    return nullptr;
+  }
+  return table(index, error);
+}
+
+bool GameDataFile::decodeAll(string &error, unsigned threads)
+{
+  vector<string> errors(_entries.size());
+  atomic<size_t> next(0);
+  // every worker only touches its own slots of _tables
+  auto worker = [&]() {
+    for (size_t i = next++; i < _entries.size(); i = next++) {
+      table(i, errors[i]);
+    }
+  };
+  size_t threadCount = threads > 0 ? threads : max(1u, thread::hardware_concurrency());
+  threadCount = min(threadCount, _entries.size());
+  vector<thread> workers;
+  for (size_t i = 1; i < threadCount; ++i) {
+    workers.push_back(thread(worker));
+  }
+  worker();
+  for (thread &t : workers) {
+    t.join();
+  }
+  for (const string &message : errors) {
+    if (!message.empty()) {
+      error = message;
+      return false;
+    }
+  }
+  return true;
+}
+
+int describeGameDataFile(const string &path)
+{
+  GameDataFile file;
+  string error;
+  auto begin = chrono::steady_clock::now();
+  if (!file.open(path, error) || !file.verify(error) || !file.decodeAll(error)) {
+    cerr << path << ": " << error << endl;
+    return 1;
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+  size_t rows = 0;
+  for (size_t i = 0; i < file.tableCount(); ++i) {
+    const DataTable *table = file.table(i, error);
+    const DataTableSchema &schema = table->schema();
+    rows += table->rowCount();
+    cout << table->name() << (schema.isMatrix() ? " matrix " : schema.kind == SchemaGroupTable ? " group " : " table ")
+         << table->rowCount() << " rows" << (schema.isColumnar() ? ", columnar" : "");
+    if (!schema.key.empty()) {
+      cout << ", key " << schema.key;
+    }
+    cout << endl;
+    for (const DataColumn &column : table->columns()) {
+      cout << "  " << column.name() << " " << column.type() << endl;
+    }
+  }
+  cout << file.tableCount() << " tables, " << rows << " rows decoded in " << seconds * 1e3 << " ms" << endl;
+  return 0;
+}
@@ -0,0 +1,207 @@
+//
+//  GameDataReader.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef GameDataReader_hpp
+#define GameDataReader_hpp
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "StringRef.hpp"
+
+using namespace std;
+
+// Reads a game.dat built with --table-index without any generated code.
+// Every index entry carries the schema of its table, which is enough to
+// decode the table into typed columns. Strings are views into the loaded
+// file, so the file has to outlive everything read from it.
+
+// how the values of a column are laid out, written into the schema as one byte
+enum ColumnEncoding : uint8_t
+{
+  Int32Encoding = 1,    // int, BOOL
+  Int64Encoding,        // long, NSInteger
+  DoubleEncoding,       // double
+  StringEncoding,       // string, id, stringId, groupId, matrix cells
+  StringListEncoding,   // set, array, set<string>...
+  Int32ListEncoding,    // set<int>, array<int>
+  Int64ListEncoding,    // set<long>, array<long>
+  DoubleListEncoding,   // set<double>, array<double>
+};
+
+static const uint8_t kSchemaVersion = 1;
+
+enum SchemaKind : uint8_t { SchemaTable = 0, SchemaGroupTable = 1, SchemaMatrix = 2 };
+enum SchemaFlags : uint8_t { SchemaColumnar = 1, SchemaEmbeddedStrings = 2, SchemaPackedNumbers = 4 };
+
+struct DataColumnSchema
+{
+  string name;
+  // the cell of the type row, "int", "array<long>"...
+  string type;
+  ColumnEncoding encoding;
+};
+
+// Layout of the schema bytes, integers little endian, strings as uint64 length + bytes:
+//   uint8 version, uint8 kind, uint8 flags
+//   table:  key, uint32 column count, per column: name, type, uint8 encoding,
+//           uint32 embedded string count, per embedded column: its getter name
+//   matrix: function name, column header, row header, value type
+struct DataTableSchema
+{
+  SchemaKind kind = SchemaTable;
+  uint8_t flags = 0;
+  string key;
+  vector<DataColumnSchema> columns;
+  vector<string> embeddedStrings;
+  string functionName;
+  string colName;
+  string rowName;
+  string valueType;
+
+  bool isMatrix() const { return kind == SchemaMatrix; }
+  bool isColumnar() const { return (flags & SchemaColumnar) != 0; }
+  // integer columns start with their NumberPacking
+  bool packsNumbers() const { return (flags & SchemaPackedNumbers) != 0; }
+};
+
+bool parseTableSchema(const char *data, size_t length, DataTableSchema &schema);
+
+class DataColumn
+{
+  friend class DataTable;
+private:
+  DataColumnSchema _schema;
+  vector<int32_t> _int32s;
+  vector<int64_t> _int64s;
+  vector<double> _doubles;
+  vector<StringRef> _strings;
+  // lists: items of row i are [_listOffsets[i], _listOffsets[i + 1])
+  vector<uint32_t> _listOffsets;
+public:
+  const string &name() const { return _schema.name; }
+  const string &type() const { return _schema.type; }
+  ColumnEncoding encoding() const { return _schema.encoding; }
+  bool isList() const { return _schema.encoding >= StringListEncoding; }
+  bool isNumeric() const { return _schema.encoding <= DoubleEncoding; }
+
+  // scalar columns, the row has to be in range and the encoding has to match
+  int32_t int32At(size_t row) const { return _int32s[row]; }
+  int64_t int64At(size_t row) const { return _int64s[row]; }
+  double doubleAt(size_t row) const { return _doubles[row]; }
+  StringRef stringAt(size_t row) const { return _strings[row]; }
+  // any numeric column widened, 0 for everything else
+  int64_t integerAt(size_t row) const;
+  double numberAt(size_t row) const;
+
+  // list columns, the items of one row are contiguous
+  size_t listSize(size_t row) const { return _listOffsets[row + 1] - _listOffsets[row]; }
+  const int32_t *int32List(size_t row) const { return _int32s.data() + _listOffsets[row]; }
+  const int64_t *int64List(size_t row) const { return _int64s.data() + _listOffsets[row]; }
+  const double *doubleList(size_t row) const { return _doubles.data() + _listOffsets[row]; }
+  const StringRef *stringList(size_t row) const { return _strings.data() + _listOffsets[row]; }
+
+  // whole scalar columns for scans
+  const vector<int32_t> &int32Values() const { return _int32s; }
+  const vector<int64_t> &int64Values() const { return _int64s; }
+  const vector<double> &doubleValues() const { return _doubles; }
+  const vector<StringRef> &stringValues() const { return _strings; }
+};
+
+// One decoded table. A matrix is exposed as a table too: the first column
+// holds the row keys, then one string column per matrix column.
+class DataTable
+{
+  friend class GameDataFile;
+private:
+  string _name;
+  DataTableSchema _schema;
+  size_t _rowCount = 0;
+  vector<DataColumn> _columns;
+
+  bool _decodeRows(const char *data, size_t length, string &error);
+  bool _decodeColumns(const char *data, size_t length, string &error);
+  bool _decodeMatrix(const char *data, size_t length, string &error);
+  bool _decode(const char *data, size_t length, string &error);
+public:
+  // cheap handle on one row, iterating a table allocates nothing
+  class Row
+  {
+  private:
+    const DataTable *_table;
+    size_t _index;
+  public:
+    Row(const DataTable *table, size_t index) : _table(table), _index(index) {}
+    size_t index() const { return _index; }
+    const DataColumn &column(size_t column) const { return _table->_columns[column]; }
+    int32_t int32At(size_t column) const { return _table->_columns[column].int32At(_index); }
+    int64_t int64At(size_t column) const { return _table->_columns[column].int64At(_index); }
+    double doubleAt(size_t column) const { return _table->_columns[column].doubleAt(_index); }
+    StringRef stringAt(size_t column) const { return _table->_columns[column].stringAt(_index); }
+
+    Row &operator*() { return *this; }
+    Row &operator++() { ++_index; return *this; }
+    bool operator!=(const Row &other) const { return _index != other._index; }
+  };
+
+  const string &name() const { return _name; }
+  const DataTableSchema &schema() const { return _schema; }
+  size_t rowCount() const { return _rowCount; }
+  const vector<DataColumn> &columns() const { return _columns; }
+  // -1 when there is no such column
+  int columnIndex(const string &name) const;
+  const DataColumn *column(const string &name) const;
+  // first row whose key is key, -1 when there is none
+  int64_t findRow(const StringRef &key) const;
+
+  Row row(size_t index) const { return Row(this, index); }
+  Row begin() const { return Row(this, 0); }
+  Row end() const { return Row(this, _rowCount); }
+};
+
+class GameDataFile
+{
+private:
+  struct Entry
+  {
+    string name;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t crc;
+    DataTableSchema schema;
+  };
+  string _data;
+  vector<Entry> _entries;
+  vector<unique_ptr<DataTable>> _tables;
+public:
+  // reads the file and its index, tables are decoded on demand
+  bool open(const string &path, string &error);
+  // same for a file that is already in memory
+  bool load(string data, string &error);
+
+  size_t tableCount() const { return _entries.size(); }
+  const string &tableName(size_t table) const { return _entries[table].name; }
+  const DataTableSchema &tableSchema(size_t table) const { return _entries[table].schema; }
+  // -1 when the file has no such table
+  int tableIndex(const string &name) const;
+  // false when the CRC-32C of a table doesn't match the index
+  bool verify(string &error) const;
+
+  // decodes every table that isn't decoded yet, threads 0 uses every core
+  bool decodeAll(string &error, unsigned threads = 0);
+  // decodes the table the first time, nullptr and error when it is damaged.
+  // Not thread safe, call decodeAll first when several threads read tables.
+  const DataTable *table(size_t table, string &error);
+  const DataTable *table(const string &name, string &error);
+};
+
+// --describe, decodes every table of the file and prints its schema, returns the exit code
+int describeGameDataFile(const string &path);
+
+#endif /* GameDataReader_hpp */
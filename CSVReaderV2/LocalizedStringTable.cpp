@@ -0,0 +1,129 @@
+//
+//  LocalizedStringTable.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "LocalizedStringTable.hpp"
+#include <algorithm>
+
+static const size_t kInitialSlots = 64;
+
+LocalizedStringTable::LocalizedStringTable()
+{
+  _arena = std::make_unique<Arena>(16 * 1024);
+}
+
+size_t LocalizedStringTable::_findSlot(const StringRef &key, uint32_t hash) const
+{
+  // linear probing, the table is kept at most half full
+  size_t mask = _slots.size() - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    const Slot &slot = _slots[i];
+    if (slot.entry == 0 || (slot.hash == hash && _entries[slot.entry - 1].key == key)) {
+      return i;
+    }
+  }
+}
+
+void LocalizedStringTable::_grow()
+{
+  vector<Slot> slots(_slots.size() > 0 ? _slots.size() * 2 : kInitialSlots, Slot{0, 0});
+  size_t mask = slots.size() - 1;
+  for (const Slot &slot : _slots) {
+    if (slot.entry != 0) {
+      size_t i = slot.hash & mask;
+      while (slots[i].entry != 0) {
+        i = (i + 1) & mask;
+      }
+      slots[i] = slot;
+    }
+  }
+  _slots.swap(slots);
+}
+
+bool LocalizedStringTable::set(const string &key, const string &value)
+{
+  if ((_entries.size() + 1) * 2 > _slots.size()) {
+    _grow();
+  }
+  StringRef keyRef(key.data(), key.size());
+  uint32_t hash = (uint32_t)StringRefHash()(keyRef);
+  Slot *slot = &_slots[_findSlot(keyRef, hash)];
+  if (slot->entry != 0) {
+    _entries[slot->entry - 1].value = _arena->copyString(value);
+    _textBytes += value.size();
+    return false;
+  }
+  _entries.push_back({_arena->copyString(key), _arena->copyString(value)});
+  _textBytes += key.size() + value.size();
+  slot->hash = hash;
+  slot->entry = (uint32_t)_entries.size();
+  return true;
+}
+
+bool LocalizedStringTable::contains(const string &key) const
+{
+  if (_slots.size() == 0) {
+    return false;
+  }
+  StringRef keyRef(key.data(), key.size());
+  uint32_t hash = (uint32_t)StringRefHash()(keyRef);
+  return _slots[_findSlot(keyRef, hash)].entry != 0;
+}
+
+void LocalizedStringTable::clear()
+{
+  _entries.clear();
+  _slots.clear();
+  _arena->release();
+  _textBytes = 0;
+}
+
+vector<LocalizedStringTable::Entry> LocalizedStringTable::sortedEntries() const
+{
+  vector<Entry> entries(_entries);
+  sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+    return a.key < b.key;
+  });
+  return entries;
+}
+
+// uint32 key length, key, uint32 value length, value, entry after entry
+bool LocalizedStringTable::writeSortedRun(const string &path) const
+{
+  ofstream outfile(path, ofstream::binary | ofstream::trunc);
+  for (const Entry &entry : sortedEntries()) {
+    for (const StringRef &text : {entry.key, entry.value}) {
+      uint32_t length = (uint32_t)text.size;
+      outfile.write((const char *)&length, sizeof(length));
+      outfile.write(text.data, text.size);
+    }
+  }
+  return outfile.good();
+}
+
+bool LocalizedRunReader::open(const string &path)
+{
+  _stream.open(path, ifstream::binary);
+  return _stream.good();
+}
+
+bool LocalizedRunReader::next(LocalizedStringTable::Entry &entry)
+{
+  for (string *text : {&_key, &_value}) {
+    uint32_t length;
+    if (!_stream.read((char *)&length, sizeof(length))) {
+      return false;
+    }
+    text->resize(length);
+    if (length > 0 && !_stream.read(&(*text)[0], length)) {
+      return false;
+    }
+  }
+  entry.key = StringRef(_key.data(), _key.size());
+  entry.value = StringRef(_value.data(), _value.size());
+  return true;
+}
@@ -0,0 +1,80 @@
+//
+//  LocalizedStringTable.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef LocalizedStringTable_hpp
+#define LocalizedStringTable_hpp
+
+#include <stdio.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arena.hpp"
+#include "StringRef.hpp"
+
+using namespace std;
+
+// Localized strings of one source file. Keys and values are copied into an
+// arena and indexed by an open addressing hash table, entries stay in
+// insertion order. Nothing here is sorted, DataBuilder merges the tables of
+// all sources and sorts once when it writes Localizable.strings.
+class LocalizedStringTable
+{
+public:
+  struct Entry
+  {
+    StringRef key;
+    StringRef value;
+  };
+private:
+  struct Slot
+  {
+    uint32_t hash;
+    // index into _entries plus one, 0 marks an empty slot
+    uint32_t entry;
+  };
+  unique_ptr<Arena> _arena;
+  vector<Entry> _entries;
+  vector<Slot> _slots;
+  size_t _textBytes = 0;
+  
+  size_t _findSlot(const StringRef &key, uint32_t hash) const;
+  void _grow();
+public:
+  LocalizedStringTable();
+  
+  // returns false if the key was already there, its value is replaced anyway
+  bool set(const string &key, const string &value);
+  bool contains(const string &key) const;
+  void clear();
+  
+  size_t size() const { return _entries.size(); }
+  // roughly what the table holds on the heap
+  size_t byteSize() const { return _textBytes + _entries.size() * sizeof(Entry) + _slots.size() * sizeof(Slot); }
+  // keys are unique, so this is the order every merge wants
+  vector<Entry> sortedEntries() const;
+  // sortedEntries as a run file, see LocalizedRunReader
+  bool writeSortedRun(const string &path) const;
+  vector<Entry>::const_iterator begin() const { return _entries.begin(); }
+  vector<Entry>::const_iterator end() const { return _entries.end(); }
+};
+
+// Reads back a run written by writeSortedRun one entry at a time, the
+// entry points into the reader and is valid until the next call.
+class LocalizedRunReader
+{
+private:
+  ifstream _stream;
+  string _key;
+  string _value;
+public:
+  bool open(const string &path);
+  bool next(LocalizedStringTable::Entry &entry);
+};
+
+#endif /* LocalizedStringTable_hpp */
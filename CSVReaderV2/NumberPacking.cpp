@@ -0,0 +1,259 @@
+//
+//  NumberPacking.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "NumberPacking.hpp"
+#include <string.h>
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define NUMBER_PACKING_AVX2 1
+static bool _hasAVX2 = __builtin_cpu_supports("avx2");
+#endif
+
+bool isPackedNumberType(const string &columnType)
+{
+  return columnType == "int" || columnType == "bool" || columnType == "BOOL" ||
+         columnType == "long" || columnType == "NSInteger";
+}
+
+static int _bitWidth(uint64_t range)
+{
+  return range == 0 ? 0 : 64 - __builtin_clzll(range);
+}
+
+static size_t _wordCount(size_t count, int bits)
+{
+  return (count * bits + 63) / 64;
+}
+
+// everything is computed modulo 2^64, so ranges and steps that overflow int64 still round trip
+static void _putBits(const vector<uint64_t> &packed, int bits, bb::ByteBuffer &buffer)
+{
+  vector<uint64_t> words(_wordCount(packed.size(), bits), 0);
+  for (size_t i = 0; i < packed.size() && bits > 0; ++i) {
+    size_t bit = i * bits;
+    words[bit / 64] |= packed[i] << (bit % 64);
+    if (bit % 64 + bits > 64) {
+      words[bit / 64 + 1] |= packed[i] >> (64 - bit % 64);
+    }
+  }
+  for (uint64_t word : words) {
+    buffer.putLong(word);
+  }
+}
+
+void packNumbers(const vector<int64_t> &values, size_t width, bb::ByteBuffer &buffer)
+{
+  size_t count = values.size();
+  int64_t minimum = count > 0 ? values[0] : 0;
+  int64_t maximum = minimum;
+  int64_t smallestStep = count > 1 ? (int64_t)((uint64_t)values[1] - (uint64_t)values[0]) : 0;
+  int64_t largestStep = smallestStep;
+  size_t runs = count > 0 ? 1 : 0;
+  for (size_t i = 1; i < count; ++i) {
+    minimum = min(minimum, values[i]);
+    maximum = max(maximum, values[i]);
+    int64_t step = (int64_t)((uint64_t)values[i] - (uint64_t)values[i - 1]);
+    smallestStep = min(smallestStep, step);
+    largestStep = max(largestStep, step);
+    runs += values[i] != values[i - 1];
+  }
+  int frameBits = _bitWidth((uint64_t)maximum - (uint64_t)minimum);
+  int deltaBits = _bitWidth((uint64_t)largestStep - (uint64_t)smallestStep);
+
+  // the smallest wins, ties go to the one that is cheaper to read
+  NumberPacking packing = PlainNumbers;
+  size_t size = count * width;
+  auto consider = [&](NumberPacking candidate, size_t candidateSize) {
+    if (candidateSize < size) {
+      packing = candidate;
+      size = candidateSize;
+    }
+  };
+  if (count > 0 && runs == 1) {
+    consider(ConstantNumbers, 8);
+  }
+  consider(FrameNumbers, 12 + 8 * _wordCount(count, frameBits));
+  if (count > 1) {
+    consider(DeltaNumbers, 20 + 8 * _wordCount(count - 1, deltaBits));
+  }
+  consider(RunNumbers, 4 + 12 * runs);
+
+  buffer.putInt(packing);
+  vector<uint64_t> packed;
+  switch (packing) {
+    case PlainNumbers:
+      for (int64_t value : values) {
+        if (width == 8) {
+          buffer.putLong(value);
+        } else {
+          buffer.putInt((uint32_t)value);
+        }
+      }
+      break;
+    case ConstantNumbers:
+      buffer.putLong(values[0]);
+      break;
+    case FrameNumbers:
+      buffer.putLong(minimum);
+      buffer.putInt(frameBits);
+      for (int64_t value : values) {
+        packed.push_back((uint64_t)value - (uint64_t)minimum);
+      }
+      _putBits(packed, frameBits, buffer);
+      break;
+    case DeltaNumbers:
+      buffer.putLong(values[0]);
+      buffer.putLong(smallestStep);
+      buffer.putInt(deltaBits);
+      for (size_t i = 1; i < count; ++i) {
+        packed.push_back((uint64_t)values[i] - (uint64_t)values[i - 1] - (uint64_t)smallestStep);
+      }
+      _putBits(packed, deltaBits, buffer);
+      break;
+    case RunNumbers:
+      buffer.putInt((uint32_t)runs);
+      for (size_t i = 1; i <= count; ++i) {
+        if (i == count || values[i] != values[i - 1]) {
+          buffer.putInt((uint32_t)i);
+          buffer.putLong(values[i - 1]);
+        }
+      }
+      break;
+  }
+}
+
+#if NUMBER_PACKING_AVX2
+// four values per step: one unaligned 8 byte load per lane holds the whole
+// value when bits <= 56, shifted into place by its bit offset within the byte
+__attribute__((target("avx2")))
+static size_t _unpackAVX2(const uint8_t *bytes, size_t byteCount, size_t count, int bits, uint64_t reference, int64_t *values)
+{
+  __m256i mask = _mm256_set1_epi64x((1LL << bits) - 1);
+  __m256i base = _mm256_set1_epi64x(reference);
+  __m256i lanes = _mm256_set_epi64x(3 * bits, 2 * bits, bits, 0);
+  __m256i seven = _mm256_set1_epi64x(7);
+  size_t i = 0;
+  for (; i + 4 <= count && ((i + 3) * bits) / 8 + 8 <= byteCount; i += 4) {
+    __m256i bit = _mm256_add_epi64(_mm256_set1_epi64x(i * bits), lanes);
+    __m256i word = _mm256_i64gather_epi64((const long long *)bytes, _mm256_srli_epi64(bit, 3), 1);
+    __m256i value = _mm256_and_si256(_mm256_srlv_epi64(word, _mm256_and_si256(bit, seven)), mask);
+    _mm256_storeu_si256((__m256i *)(values + i), _mm256_add_epi64(value, base));
+  }
+  return i;
+}
+#endif
+
+static void _unpackBits(const uint8_t *bytes, size_t count, int bits, uint64_t reference, int64_t *values)
+{
+  size_t i = 0;
+#if NUMBER_PACKING_AVX2
+  if (_hasAVX2 && bits > 0 && bits <= 56) {
+    i = _unpackAVX2(bytes, _wordCount(count, bits) * 8, count, bits, reference, values);
+  }
+#endif
+  uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+  for (; i < count; ++i) {
+    size_t bit = i * bits;
+    uint64_t word = 0;
+    uint64_t next = 0;
+    memcpy(&word, bytes + bit / 64 * 8, 8);
+    uint64_t value = word >> (bit % 64);
+    if (bit % 64 + bits > 64) {
+      memcpy(&next, bytes + bit / 64 * 8 + 8, 8);
+      value |= next << (64 - bit % 64);
+    }
+    values[i] = (int64_t)(reference + (value & mask));
+  }
+}
+
+template <typename T>
+static bool _read(const char *data, size_t length, size_t &position, T &value)
+{
+  if (sizeof(T) > length - position) {
+    return false;
+  }
+  memcpy(&value, data + position, sizeof(T));
+  position += sizeof(T);
+  return true;
+}
+
+bool unpackNumbers(const char *data, size_t length, size_t &position, size_t count, size_t width, int64_t *values)
+{
+  int32_t packing = 0;
+  if (!_read(data, length, position, packing)) {
+    return false;
+  }
+  int64_t first = 0;
+  uint64_t reference = 0;
+  int32_t bits = 0;
+  switch (packing) {
+    case PlainNumbers:
+      if (count > (length - position) / width) {
+        return false;
+      }
+      for (size_t i = 0; i < count; ++i) {
+        if (width == 8) {
+          _read(data, length, position, values[i]);
+        } else {
+          int32_t value = 0;
+          _read(data, length, position, value);
+          values[i] = value;
+        }
+      }
+      return true;
+    case ConstantNumbers:
+      if (!_read(data, length, position, first)) {
+        return false;
+      }
+      fill(values, values + count, first);
+      return true;
+    case RunNumbers: {
+      int32_t runs = 0;
+      if (!_read(data, length, position, runs) || runs < 0 || (size_t)runs > (length - position) / 12) {
+        return false;
+      }
+      size_t row = 0;
+      for (int32_t run = 0; run < runs; ++run) {
+        uint32_t end = 0;
+        _read(data, length, position, end);
+        _read(data, length, position, first);
+        if (end < row || end > count) {
+          return false;
+        }
+        fill(values + row, values + end, first);
+        row = end;
+      }
+      return row == count;
+    }
+    case FrameNumbers:
+    case DeltaNumbers: {
+      if ((packing == DeltaNumbers && !_read(data, length, position, first)) ||
+          !_read(data, length, position, reference) || !_read(data, length, position, bits) || bits < 0 || bits > 64) {
+        return false;
+      }
+      size_t packed = packing == DeltaNumbers && count > 0 ? count - 1 : count;
+      if (_wordCount(packed, bits) * 8 > length - position) {
+        return false;
+      }
+      int64_t *target = packing == DeltaNumbers && count > 0 ? values + 1 : values;
+      _unpackBits((const uint8_t *)data + position, packed, bits, reference, target);
+      position += _wordCount(packed, bits) * 8;
+      if (packing == DeltaNumbers && count > 0) {
+        values[0] = first;
+        for (size_t i = 1; i < count; ++i) {
+          values[i] = (int64_t)((uint64_t)values[i - 1] + (uint64_t)values[i]);
+        }
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,48 @@
+//
+//  NumberPacking.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef NumberPacking_hpp
+#define NumberPacking_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ByteBuffer.hpp"
+
+using namespace std;
+
+// Integer columns of a table built with ConvertOptions::packNumbers. Every
+// column picks whichever of these is smallest for its values and starts
+// with it as an int32, integers are little endian:
+enum NumberPacking : int32_t
+{
+  // the values as they are, 4 or 8 bytes each
+  PlainNumbers = 0,
+  // int64 value of every row
+  ConstantNumbers,
+  // int64 minimum, int32 bits, then value - minimum of every row in bits bits
+  FrameNumbers,
+  // int64 first value, int64 smallest step, int32 bits, then step - smallest
+  // step from every row to the next in bits bits
+  DeltaNumbers,
+  // int32 run count, per run the int32 row it ends before and its int64 value
+  RunNumbers,
+};
+// Bits are packed lowest first into (count * bits + 63) / 64 uint64 words.
+
+// whether a column of this type (the cell of the type row) is packed,
+// ref<...> columns are patched in place after the build and stay plain
+bool isPackedNumberType(const string &columnType);
+
+// width is what a plain value takes, 4 or 8
+void packNumbers(const vector<int64_t> &values, size_t width, bb::ByteBuffer &buffer);
+// reads a column of count values at position, false when it is damaged
+bool unpackNumbers(const char *data, size_t length, size_t &position, size_t count, size_t width, int64_t *values);
+
+#endif /* NumberPacking_hpp */
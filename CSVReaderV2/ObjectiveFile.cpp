@@ -7,6 +7,8 @@
 //
 
 #include "ObjectiveFile.hpp"
+#include <algorithm>
+#include "Profiler.hpp"
 
 using namespace std;
 
@@ -40,6 +42,14 @@ string ObjectiveType::type() const {
   return _typeName;
 }
 
+void ObjectiveType::write(CodeWriter &writer) const {
+  writer << _typeName << (_isPointer ? " *" : " ");
+}
+
+size_t ObjectiveType::sizeHint() const {
+  return _typeName.size() + 2;
+}
+
 ObjectiveProperty::ObjectiveProperty(string propertyName, ObjectiveType *propertyType, bool readOnly, bool atomic) {
   assert(propertyType != nullptr);
   _propertyName = propertyName;
@@ -48,26 +58,27 @@ ObjectiveProperty::ObjectiveProperty(string propertyName, ObjectiveType *propert
   _atomic = atomic;
 }
 
-string ObjectiveProperty::defineContent() const {
-  string file = "@property (" ;
-  file += _atomic ? "atomic" : "nonatomic";
-  file += ",";
-  file += _readOnly ? "readonly" : "readwrite";
-  file += ") ";
-  file += simpleDefine();
-  return file;
+void ObjectiveProperty::writeDefine(CodeWriter &writer) const {
+  writer << "@property (";
+  writer << (_atomic ? "atomic" : "nonatomic");
+  writer << ",";
+  writer << (_readOnly ? "readonly" : "readwrite");
+  writer << ") ";
+  writeSimpleDefine(writer);
 }
 
-string ObjectiveProperty::simpleDefine() const {
-  string file;
-  file += _propertyType->str();
-  file += _propertyName;
-  file += ";";
-  return file;
+void ObjectiveProperty::writeSimpleDefine(CodeWriter &writer) const {
+  _propertyType->write(writer);
+  writer << _propertyName << ";";
 }
 
-string ObjectiveProperty::staticDefine() const {
-  return "static " + simpleDefine();
+void ObjectiveProperty::writeStaticDefine(CodeWriter &writer) const {
+  writer << "static ";
+  writeSimpleDefine(writer);
+}
+
+size_t ObjectiveProperty::sizeHint() const {
+  return 32 + _propertyType->sizeHint() + _propertyName.size();
 }
 
 string ObjectiveProperty::name() const {
@@ -104,39 +115,52 @@ void ObjectiveFunction::addLines(const string &line) {
   _lines.push_back(line);
 }
 
-string ObjectiveFunction::defineContent() const {
-  
-  string content;
+void ObjectiveFunction::writeDefine(CodeWriter &writer) const {
   if (_simpleWay) {
-    content = _funcName;
+    writer << _funcName;
   } else {
-    content = _isStatic ? "+" : "-";
-    content += "(" + _returnType.str() + ")" + _funcName;
+    writer << (_isStatic ? "+" : "-") << "(";
+    _returnType.write(writer);
+    writer << ")" << _funcName;
   }
   if (_parameterTypes.size() > 0) {
     for (int i = 0; i < _parameterTypes.size(); ++i) {
       if (i > 0) {
-        content += " " + _parameterTags[i - 1];
+        writer << " " << _parameterTags[i - 1];
       }
-      content += ":(" + _parameterTypes[i].str() + ")" + _parameterNames[i];
+      writer << ":(";
+      _parameterTypes[i].write(writer);
+      writer << ")" << _parameterNames[i];
     }
   }
-  return content;
 }
 
-string ObjectiveFunction::headerContent() const {
-  string content = defineContent();
-  return content + ";";
+void ObjectiveFunction::writeHeader(CodeWriter &writer) const {
+  writeDefine(writer);
+  writer << ";";
 }
 
-string ObjectiveFunction::mainContent() const {
-  string content = defineContent();
-  content += "\n{\n";
+void ObjectiveFunction::writeMain(CodeWriter &writer) const {
+  writeDefine(writer);
+  writer << "\n{\n";
   for (int i = 0; i < _lines.size(); ++i) {
-    content += "\t" + _lines[i] + "\n";
+    writer << "\t" << _lines[i] << "\n";
   }
-  content += "}";
-  return content;
+  writer << "}";
+}
+
+size_t ObjectiveFunction::sizeHint() const {
+  size_t size = _funcName.size() + _returnType.sizeHint() + 8;
+  for (int i = 0; i < _parameterTypes.size(); ++i) {
+    size += _parameterNames[i].size() + _parameterTypes[i].sizeHint() + 4;
+  }
+  for (const string &tag : _parameterTags) {
+    size += tag.size() + 1;
+  }
+  for (const string &line : _lines) {
+    size += line.size() + 2;
+  }
+  return size;
 }
 
 StaticCPPFunction::StaticCPPFunction(const string &funcName) {
@@ -147,14 +171,21 @@ void StaticCPPFunction::addLines(const string &line) {
   _lines.push_back(line);
 }
 
-string StaticCPPFunction::mainContent() const {
-  string content = _funcName;
-  content += "\n{\n";
+void StaticCPPFunction::writeMain(CodeWriter &writer) const {
+  writer << _funcName;
+  writer << "\n{\n";
   for (int i = 0; i < _lines.size(); ++i) {
-    content += "\t" + _lines[i] + "\n";
+    writer << "\t" << _lines[i] << "\n";
+  }
+  writer << "}";
+}
+
+size_t StaticCPPFunction::sizeHint() const {
+  size_t size = _funcName.size() + 4;
+  for (const string &line : _lines) {
+    size += line.size() + 2;
   }
-  content += "}";
-  return content;
+  return size;
 }
 
 ObjectiveClass::ObjectiveClass(const string &className) {
@@ -173,35 +204,60 @@ void ObjectiveClass::addFunction(ObjectiveFunction *objectiveFunction) {
   _functionList.push_back(objectiveFunction);
 }
 
-string ObjectiveClass::headerContent() const {
-  string content = "@interface " + _className + " : NSObject\n";
-  content += "\n";
+void ObjectiveClass::writeHeader(CodeWriter &writer) const {
+  writer << "@interface " << _className << " : NSObject\n";
+  writer << "\n";
   for (ObjectiveProperty *property : _propertyList) {
-    content += property->defineContent() + "\n";
-    content += "\n";
+    property->writeDefine(writer);
+    writer << "\n";
+    writer << "\n";
   }
   for (ObjectiveFunction *oFunction : _functionList) {
-    content += oFunction->defineContent() + ";\n";
-    content += "\n";
+    oFunction->writeDefine(writer);
+    writer << ";\n";
+    writer << "\n";
   }
-  content += "@end\n";
-  return content;
+  writer << "@end\n";
 }
 
-string ObjectiveClass::mainContent() const {
-  string content = "@implementation " + _className + "\n";
+void ObjectiveClass::writeMain(CodeWriter &writer) const {
+  writer << "@implementation " << _className << "\n";
   if (_impPropertyList.size() > 0) {
-    content += "{\n";
+    writer << "{\n";
     for (ObjectiveProperty *property : _impPropertyList) {
-      content += "\t" + property->simpleDefine() + "\n";
+      writer << "\t";
+      property->writeSimpleDefine(writer);
+      writer << "\n";
     }
-    content += "}\n";
+    writer << "}\n";
   }
   for (ObjectiveFunction *oFunction : _functionList) {
-    content += oFunction->mainContent() + "\n";
+    oFunction->writeMain(writer);
+    writer << "\n";
   }
-  content += "\n@end\n";
-  return content;
+  writer << "\n@end\n";
+}
+
+size_t ObjectiveClass::headerSizeHint() const {
+  size_t size = _className.size() + 32;
+  for (ObjectiveProperty *property : _propertyList) {
+    size += property->sizeHint() + 2;
+  }
+  for (ObjectiveFunction *oFunction : _functionList) {
+    size += oFunction->sizeHint() + 3;
+  }
+  return size;
+}
+
+size_t ObjectiveClass::mainSizeHint() const {
+  size_t size = _className.size() + 32;
+  for (ObjectiveProperty *property : _impPropertyList) {
+    size += property->sizeHint() + 2;
+  }
+  for (ObjectiveFunction *oFunction : _functionList) {
+    size += oFunction->sizeHint() + 1;
+  }
+  return size;
 }
 
 string ObjectiveClass::className() const
@@ -209,40 +265,78 @@ string ObjectiveClass::className() const
   return _className;
 }
 
-string ObjectiveFile::_generateHFile() const {
-  string file = "/* This file is generated, do not modify it !*/\n";
-  file += "\n";
-  for (string header : _importHeaders) {
-    file += "#import " + header + "\n";
+void ObjectiveFile::_writeHFile(CodeWriter &writer) const {
+  size_t sizeHint = 64;
+  for (const string &header : _importHeaders) {
+    sizeHint += header.size() + 9;
+  }
+  for (const string &className : _forwardClasses) {
+    sizeHint += className.size() + 9;
+  }
+  for (const string &declaration : _declarations) {
+    sizeHint += declaration.size() + 2;
+  }
+  for (StaticCPPFunction *sf : _staticCPPList) {
+    sizeHint += sf->sizeHint() + 1;
+  }
+  for (ObjectiveClass *oc : _classList) {
+    sizeHint += oc->headerSizeHint() + 1;
+  }
+  writer.reserve(sizeHint);
+  
+  writer << "/* This file is generated, do not modify it !*/\n";
+  writer << "\n";
+  for (const string &header : _importHeaders) {
+    writer << "#import " << header << "\n";
+  }
+  writer << "\n";
+  for (const string &className : _forwardClasses) {
+    writer << "@class " << className << ";\n";
+  }
+  for (size_t i = 0; i < _declarations.size(); ++i) {
+    writer << (i > 0 ? "\n" : "") << _declarations[i] << "\n";
   }
-  file += "\n";
   for (StaticCPPFunction *sf : _staticCPPList) {
-    file += sf->mainContent() + "\n";
+    sf->writeMain(writer);
+    writer << "\n";
   }
-  file += "\n";
+  writer << "\n";
   for (ObjectiveClass *oc : _classList) {
-    file += oc->headerContent() + "\n";
+    oc->writeHeader(writer);
+    writer << "\n";
   }
-  return file;
 }
 
-string ObjectiveFile::_generateMFile() const {
-  string file = "/* This file is generated, do not modify it !*/\n";
-  file += "#import \"" + _fileName + ".h\"\n";
-  for (string header : _impImportHeaders) {
-    file += "#import " + header + "\n";
+void ObjectiveFile::_writeMFile(CodeWriter &writer) const {
+  size_t sizeHint = 64 + _fileName.size();
+  for (const string &header : _impImportHeaders) {
+    sizeHint += header.size() + 9;
+  }
+  for (ObjectiveProperty *property : _staticPropertyList) {
+    sizeHint += property->sizeHint() + 1;
+  }
+  for (ObjectiveClass *oc : _classList) {
+    sizeHint += oc->mainSizeHint() + 1;
+  }
+  writer.reserve(sizeHint);
+  
+  writer << "/* This file is generated, do not modify it !*/\n";
+  writer << "#import \"" << _fileName << ".h\"\n";
+  for (const string &header : _impImportHeaders) {
+    writer << "#import " << header << "\n";
   }
   if (_staticPropertyList.size() > 0) {
-    file += "\n";
+    writer << "\n";
     for (ObjectiveProperty *property : _staticPropertyList) {
-      file += property->staticDefine() + "\n";
+      property->writeStaticDefine(writer);
+      writer << "\n";
     }
-    file += "\n";
+    writer << "\n";
   }
   for (ObjectiveClass *oc : _classList) {
-    file += oc->mainContent() + "\n";
+    oc->writeMain(writer);
+    writer << "\n";
   }
-  return file;
 }
 
 ObjectiveFile::ObjectiveFile(string fileName) {
@@ -255,7 +349,19 @@ void ObjectiveFile::addImportHeaders(const string &header) {
 }
 
 void ObjectiveFile::addImpImportHeaders(const string &header) {
-  _impImportHeaders.push_back(header);
+  if (find(_impImportHeaders.begin(), _impImportHeaders.end(), header) == _impImportHeaders.end()) {
+    _impImportHeaders.push_back(header);
+  }
+}
+
+void ObjectiveFile::addForwardClass(const string &className) {
+  if (find(_forwardClasses.begin(), _forwardClasses.end(), className) == _forwardClasses.end()) {
+    _forwardClasses.push_back(className);
+  }
+}
+
+void ObjectiveFile::addDeclaration(const string &declaration) {
+  _declarations.push_back(declaration);
 }
 
 void ObjectiveFile::addImportFile(const ObjectiveFile &file) {
@@ -275,17 +381,36 @@ void ObjectiveFile::addStaticCPPFunction(StaticCPPFunction *staticCppFunction) {
 }
 
 void ObjectiveFile::writeToFile(string basePath) {
+  ProfileScope codeGenScope(PhaseCodeGen, "codegen");
   string headerPath = basePath + "/" + _fileName + ".h";
-  string dataH = _generateHFile();
-  ofstream dataHFile(headerPath);
-  dataHFile << dataH;
-  dataHFile.close();
+  ofstream dataHFile;
+  {
+    ProfileScope writeScope(PhaseWrite);
+    dataHFile.open(headerPath);
+  }
+  {
+    CodeWriter writer(dataHFile);
+    _writeHFile(writer);
+  }
+  {
+    ProfileScope writeScope(PhaseWrite);
+    dataHFile.close();
+  }
   
   string contentPath = basePath + "/" + _fileName + ".m";
-  string dataM = _generateMFile();
-  ofstream dataMFile(contentPath);
-  dataMFile << dataM;
-  dataMFile.close();
+  ofstream dataMFile;
+  {
+    ProfileScope writeScope(PhaseWrite);
+    dataMFile.open(contentPath);
+  }
+  {
+    CodeWriter writer(dataMFile);
+    _writeMFile(writer);
+  }
+  {
+    ProfileScope writeScope(PhaseWrite);
+    dataMFile.close();
+  }
 }
 
 string ObjectiveFile::fileName() const
@@ -309,3 +434,21 @@ ostream& operator<<(std::ostream& os, const ObjectiveFile &obj)
   return os;
 }
 
+
+ObjectiveType *ObjectiveArena::type(const string &typeName, bool isPointer)
+{
+  string key = isPointer ? typeName + "*" : typeName;
+  auto iter = _types.find(key);
+  if (iter != _types.end()) {
+    return iter->second;
+  }
+  ObjectiveType *objectiveType = make<ObjectiveType>(typeName, isPointer);
+  _types[key] = objectiveType;
+  return objectiveType;
+}
+
+void ObjectiveArena::release()
+{
+  _types.clear();
+  Arena::release();
+}
@@ -13,8 +13,11 @@
 #include <ostream>
 #include <fstream>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <assert.h>
+#include "Arena.hpp"
+#include "CodeWriter.hpp"
 
 using namespace std;
 
@@ -29,6 +32,8 @@ public:
   ObjectiveType& operator=(const ObjectiveType &other);
   string str() const;
   string type() const;
+  void write(CodeWriter &writer) const;
+  size_t sizeHint() const;
 };
 
 class ObjectiveProperty
@@ -40,9 +45,10 @@ private:
   bool _atomic;
 public:
   ObjectiveProperty(string propertyName, ObjectiveType *propertyType, bool readOnly = true, bool atomic = false);
-  string defineContent() const;
-  string simpleDefine() const;
-  string staticDefine() const;
+  void writeDefine(CodeWriter &writer) const;
+  void writeSimpleDefine(CodeWriter &writer) const;
+  void writeStaticDefine(CodeWriter &writer) const;
+  size_t sizeHint() const;
   string name() const;
   string type() const;
 };
@@ -68,9 +74,10 @@ public:
                     bool isStatic = false);
   
   void addLines(const string &line);
-  string defineContent() const;
-  string headerContent() const;
-  string mainContent() const;
+  void writeDefine(CodeWriter &writer) const;
+  void writeHeader(CodeWriter &writer) const;
+  void writeMain(CodeWriter &writer) const;
+  size_t sizeHint() const;
 };
 
 class StaticCPPFunction
@@ -81,7 +88,8 @@ private:
 public:
   StaticCPPFunction(const string &funcName);
   void addLines(const string &line);
-  string mainContent() const;
+  void writeMain(CodeWriter &writer) const;
+  size_t sizeHint() const;
 };
 
 class ObjectiveClass
@@ -98,8 +106,10 @@ public:
   void addImpProperty(ObjectiveProperty *property);
   void addFunction(ObjectiveFunction *objectiveFunction);
   
-  string headerContent() const;
-  string mainContent() const;
+  void writeHeader(CodeWriter &writer) const;
+  void writeMain(CodeWriter &writer) const;
+  size_t headerSizeHint() const;
+  size_t mainSizeHint() const;
   string className() const;
 };
 
@@ -108,15 +118,21 @@ private:
   string _fileName;
   vector<string> _importHeaders;
   vector<string> _impImportHeaders;
+  vector<string> _forwardClasses;
+  vector<string> _declarations;
   vector<ObjectiveClass *> _classList;
   vector<ObjectiveProperty *> _staticPropertyList;
   vector<StaticCPPFunction *> _staticCPPList;
-  string _generateHFile() const;
-  string _generateMFile() const;
+  void _writeHFile(CodeWriter &writer) const;
+  void _writeMFile(CodeWriter &writer) const;
 public:
   ObjectiveFile(string fileName);
   void addImportHeaders(const string &header);
   void addImpImportHeaders(const string &header);
+  // @class declaration in the header, for classes defined further down
+  void addForwardClass(const string &className);
+  // C types and the like, written to the header as they are before the classes
+  void addDeclaration(const string &declaration);
   void addImportFile(const ObjectiveFile &file);
   void addStaticProperty(ObjectiveProperty *property);
   void addClass(ObjectiveClass *objectiveClass);
@@ -127,5 +143,17 @@ public:
   friend ostream& operator<<(std::ostream& os, const ObjectiveFile &obj);
 };
 
+// Owns every node of one generated object graph so it can be dropped in one
+// go after the files are written. Types are interned, all properties of the
+// same type share a single ObjectiveType.
+class ObjectiveArena : public Arena
+{
+private:
+  unordered_map<string, ObjectiveType *> _types;
+public:
+  ObjectiveType *type(const string &typeName, bool isPointer = false);
+  void release();
+};
+
 #endif /* objectiveClass_h */
 
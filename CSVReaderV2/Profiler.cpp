@@ -0,0 +1,283 @@
+//
+//  Profiler.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "Profiler.hpp"
+#include "AllocationTracker.hpp"
+#include "Arena.hpp"
+#include "ByteBuffer.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+static const char *kPhaseNames[PhaseCount] = {"read", "tokenize", "encode", "localize", "codegen", "write"};
+
+struct TraceEvent
+{
+  string name;
+  const char *category;
+  int thread;
+  int64_t start;
+  int64_t duration;
+};
+
+static mutex _profilerMutex;
+static int64_t _totalPhaseTime[PhaseCount];
+static uint64_t _totalPhaseAllocations[PhaseCount];
+static uint64_t _totalPhaseBytes[PhaseCount];
+static bool _traceEnabled = false;
+static string _tracePath;
+static vector<TraceEvent> _traceEvents;
+static atomic<int> _nextThread(0);
+
+static thread_local ProfileScope *_currentScope = nullptr;
+static thread_local FileProfile *_currentFile = nullptr;
+static thread_local int _currentThread = -1;
+
+static int64_t _now()
+{
+  static const chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count();
+}
+
+static int _threadIndex()
+{
+  if (_currentThread < 0) {
+    _currentThread = _nextThread++;
+  }
+  return _currentThread;
+}
+
+static void _addTraceEvent(const string &name, const char *category, int64_t start, int64_t end)
+{
+  if (!_traceEnabled) {
+    return;
+  }
+  int thread = _threadIndex();
+  lock_guard<mutex> lock(_profilerMutex);
+  _traceEvents.push_back({name, category, thread, start, end - start});
+}
+
+static string _formatBytes(double bytes)
+{
+  char text[32];
+  if (bytes >= 1024 * 1024) {
+    snprintf(text, sizeof(text), "%.1f MB", bytes / (1024 * 1024));
+  } else if (bytes >= 1024) {
+    snprintf(text, sizeof(text), "%.1f KB", bytes / 1024);
+  } else {
+    snprintf(text, sizeof(text), "%.0f B", bytes);
+  }
+  return text;
+}
+
+static string _formatAllocations(const uint64_t *allocations, const uint64_t *bytes)
+{
+  string text;
+  for (int i = 0; i < PhaseCount; ++i) {
+    if (allocations[i] > 0) {
+      text += string(" ") + kPhaseNames[i] + " " + to_string(allocations[i]) + "/" + _formatBytes(bytes[i]);
+    }
+  }
+  return text;
+}
+
+static string _jsonEscape(const string &text)
+{
+  string result;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    if ((unsigned char)c >= 0x20) {
+      result += c;
+    }
+  }
+  return result;
+}
+
+ProfileScope::ProfileScope(ProfilePhase phase, const char *name)
+{
+  _phase = phase;
+  _name = name;
+  _childTime = 0;
+  _childAllocations = 0;
+  _childBytes = 0;
+  _parent = _currentScope;
+  _currentScope = this;
+  _startAllocations = AllocationTracker::threadAllocations();
+  _startBytes = AllocationTracker::threadAllocatedBytes();
+  _start = _now();
+}
+
+ProfileScope::~ProfileScope()
+{
+  int64_t end = _now();
+  int64_t elapsed = end - _start;
+  int64_t exclusive = elapsed - _childTime;
+  uint64_t allocations = AllocationTracker::threadAllocations() - _startAllocations;
+  uint64_t bytes = AllocationTracker::threadAllocatedBytes() - _startBytes;
+  if (_parent != nullptr) {
+    _parent->_childTime += elapsed;
+    _parent->_childAllocations += allocations;
+    _parent->_childBytes += bytes;
+  }
+  _currentScope = _parent;
+  if (_currentFile != nullptr) {
+    _currentFile->_phaseTime[_phase] += exclusive;
+    _currentFile->_phaseAllocations[_phase] += allocations - _childAllocations;
+    _currentFile->_phaseBytes[_phase] += bytes - _childBytes;
+  } else {
+    lock_guard<mutex> lock(_profilerMutex);
+    _totalPhaseTime[_phase] += exclusive;
+    _totalPhaseAllocations[_phase] += allocations - _childAllocations;
+    _totalPhaseBytes[_phase] += bytes - _childBytes;
+  }
+  if (_name != nullptr) {
+    _addTraceEvent(_name, kPhaseNames[_phase], _start, end);
+  }
+}
+
+FileProfile::FileProfile(const string &fileName, size_t bytesIn)
+{
+  _fileName = fileName;
+  _bytesIn = bytesIn;
+  _bytesOut = 0;
+  _rows = 0;
+  for (int i = 0; i < PhaseCount; ++i) {
+    _phaseTime[i] = 0;
+    _phaseAllocations[i] = 0;
+    _phaseBytes[i] = 0;
+  }
+  _startAllocations = AllocationTracker::threadAllocations();
+  _startBytes = AllocationTracker::threadAllocatedBytes();
+  _previous = _currentFile;
+  _currentFile = this;
+  _start = _now();
+}
+
+FileProfile::~FileProfile()
+{
+  int64_t end = _now();
+  _currentFile = _previous;
+  _addTraceEvent(_fileName, "file", _start, end);
+  
+  double seconds = (end - _start) / 1e9;
+  char line[512];
+  int length = snprintf(line, sizeof(line), "%-24s %9zu B in %9zu B out %7zu rows %8.2f ms %7.1f MB/s |",
+                        _fileName.c_str(), _bytesIn, _bytesOut, _rows, seconds * 1e3,
+                        seconds > 0 ? _bytesIn / seconds / (1024.0 * 1024.0) : 0.0);
+  for (int i = 0; i < PhaseCount && length < sizeof(line); ++i) {
+    if (_phaseTime[i] > 0) {
+      length += snprintf(line + length, sizeof(line) - length, " %s %.2f", kPhaseNames[i], _phaseTime[i] / 1e6);
+    }
+  }
+  cout << line << endl;
+  if (AllocationTracker::isEnabled()) {
+    uint64_t allocations = AllocationTracker::threadAllocations() - _startAllocations;
+    uint64_t bytes = AllocationTracker::threadAllocatedBytes() - _startBytes;
+    cout << "  allocations " << allocations << " (" << _formatBytes(bytes) << ") |"
+         << _formatAllocations(_phaseAllocations, _phaseBytes)
+         << " | peak heap " << _formatBytes(AllocationTracker::peakLiveBytes())
+         << " peak rss " << _formatBytes(AllocationTracker::peakResidentBytes()) << endl;
+  }
+  
+  lock_guard<mutex> lock(_profilerMutex);
+  for (int i = 0; i < PhaseCount; ++i) {
+    _totalPhaseTime[i] += _phaseTime[i];
+    _totalPhaseAllocations[i] += _phaseAllocations[i];
+    _totalPhaseBytes[i] += _phaseBytes[i];
+  }
+}
+
+void Profiler::addRows(size_t rows)
+{
+  if (_currentFile != nullptr) {
+    _currentFile->_rows += rows;
+  }
+}
+
+void Profiler::addBytesOut(size_t bytes)
+{
+  if (_currentFile != nullptr) {
+    _currentFile->_bytesOut += bytes;
+  }
+}
+
+void Profiler::enableTrace(const string &tracePath)
+{
+  lock_guard<mutex> lock(_profilerMutex);
+  _tracePath = tracePath;
+  _traceEnabled = true;
+}
+
+void Profiler::enableAllocationTracking()
+{
+  AllocationTracker::setEnabled(true);
+}
+
+void Profiler::writeTrace()
+{
+  if (!_traceEnabled) {
+    return;
+  }
+  lock_guard<mutex> lock(_profilerMutex);
+  ofstream trace(_tracePath);
+  trace << "{\"traceEvents\":[\n";
+  for (int thread = 0; thread < _nextThread; ++thread) {
+    trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+          << ",\"args\":{\"name\":\"" << (thread == 0 ? "main" : "worker " + to_string(thread)) << "\"}},\n";
+  }
+  char timing[64];
+  for (size_t i = 0; i < _traceEvents.size(); ++i) {
+    const TraceEvent &event = _traceEvents[i];
+    snprintf(timing, sizeof(timing), "\"ts\":%.3f,\"dur\":%.3f", event.start / 1e3, event.duration / 1e3);
+    trace << "{\"name\":\"" << _jsonEscape(event.name) << "\",\"cat\":\"" << event.category
+          << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << "," << timing << "}";
+    trace << (i + 1 < _traceEvents.size() ? ",\n" : "\n");
+  }
+  trace << "],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void Profiler::resetTotals()
+{
+  lock_guard<mutex> lock(_profilerMutex);
+  for (int i = 0; i < PhaseCount; ++i) {
+    _totalPhaseTime[i] = 0;
+    _totalPhaseAllocations[i] = 0;
+    _totalPhaseBytes[i] = 0;
+  }
+  // a watch process writes the trace of every rebuild on its own
+  vector<TraceEvent>().swap(_traceEvents);
+}
+
+void Profiler::printTotals(ostream &os)
+{
+  lock_guard<mutex> lock(_profilerMutex);
+  os << "phases:";
+  char phase[64];
+  for (int i = 0; i < PhaseCount; ++i) {
+    snprintf(phase, sizeof(phase), " %s %.2f ms", kPhaseNames[i], _totalPhaseTime[i] / 1e6);
+    os << phase;
+  }
+  os << endl;
+  if (AllocationTracker::isEnabled()) {
+    os << "allocations " << AllocationTracker::totalAllocations()
+       << " (" << _formatBytes(AllocationTracker::totalAllocatedBytes()) << ") |"
+       << _formatAllocations(_totalPhaseAllocations, _totalPhaseBytes)
+       << " | live heap " << _formatBytes(AllocationTracker::liveBytes())
+       << " peak heap " << _formatBytes(AllocationTracker::peakLiveBytes())
+       << " peak rss " << _formatBytes(AllocationTracker::peakResidentBytes()) << endl;
+    os << "ByteBuffer growth " << bb::ByteBuffer::growthCount() << " (" << _formatBytes(bb::ByteBuffer::growthBytes()) << ")"
+       << " arena blocks " << Arena::totalBlockCount() << " (" << _formatBytes(Arena::totalBlockBytes()) << ")" << endl;
+  }
+}
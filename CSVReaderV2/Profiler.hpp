@@ -0,0 +1,84 @@
+//
+//  Profiler.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#include <stdio.h>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+enum ProfilePhase { PhaseRead, PhaseTokenize, PhaseEncode, PhaseLocalize, PhaseCodeGen, PhaseWrite, PhaseCount };
+
+// Times one phase on the current thread. Scopes nest and only count their
+// own time, so an encode scope around a line doesn't also count the
+// localization scope inside it. Named scopes become trace slices, unnamed
+// ones are cheap enough to put around every line. With allocation tracking
+// on, heap allocations are attributed to phases the same way.
+class ProfileScope
+{
+private:
+  ProfilePhase _phase;
+  const char *_name;
+  int64_t _start;
+  int64_t _childTime;
+  uint64_t _startAllocations;
+  uint64_t _startBytes;
+  uint64_t _childAllocations;
+  uint64_t _childBytes;
+  ProfileScope *_parent;
+public:
+  ProfileScope(ProfilePhase phase, const char *name = nullptr);
+  ~ProfileScope();
+};
+
+// Collects rows, bytes and phase times of one source file and prints its
+// summary line when it goes out of scope.
+class FileProfile
+{
+private:
+  string _fileName;
+  size_t _bytesIn;
+  size_t _bytesOut;
+  size_t _rows;
+  int64_t _start;
+  int64_t _phaseTime[PhaseCount];
+  uint64_t _startAllocations;
+  uint64_t _startBytes;
+  uint64_t _phaseAllocations[PhaseCount];
+  uint64_t _phaseBytes[PhaseCount];
+  FileProfile *_previous;
+  friend class ProfileScope;
+  friend class Profiler;
+public:
+  FileProfile(const string &fileName, size_t bytesIn);
+  ~FileProfile();
+};
+
+class Profiler
+{
+public:
+  // adds to the file being profiled on this thread, if any
+  static void addRows(size_t rows);
+  static void addBytesOut(size_t bytes);
+  
+  // records a Chrome trace-event timeline (chrome://tracing, Perfetto)
+  static void enableTrace(const string &tracePath);
+  static void writeTrace();
+  
+  // per phase and per file heap statistics, see AllocationTracker
+  static void enableAllocationTracking();
+  
+  // phase totals and trace events of everything since the last reset
+  static void resetTotals();
+  static void printTotals(ostream &os);
+};
+
+#endif /* Profiler_hpp */
@@ -17,6 +17,12 @@
 #include <ostream>
 #include <unordered_map>
 #include <algorithm>
+#include "ColumnarTable.hpp"
+#include "GameDataReader.hpp"
+#include "NumberPacking.hpp"
+#include "Profiler.hpp"
+#include "SourceIngest.hpp"
+#include "TextHygiene.hpp"
 
 using namespace std;
 
@@ -35,6 +41,35 @@ vector<string> splitStr(const string &str, const string &token) {
   return res;
 }
 
+void splitCells(const string &str, const char *separators, vector<string> &cells)
+{
+  cells.clear();
+  size_t start = 0;
+  size_t end;
+  while ((end = str.find_first_of(separators, start)) != string::npos) {
+    cells.emplace_back(str, start, end - start);
+    start = end + 1;
+  }
+  if (start < str.size() || cells.empty()) {
+    cells.emplace_back(str, start, string::npos);
+  }
+}
+
+bool TableSchema::operator==(const TableSchema &other) const
+{
+  return name == other.name &&
+         isMatrix == other.isMatrix &&
+         propertyList == other.propertyList &&
+         propertyTypeList == other.propertyTypeList &&
+         key == other.key &&
+         isGroup == other.isGroup &&
+         isReferenced == other.isReferenced &&
+         functionName == other.functionName &&
+         colName == other.colName &&
+         rowName == other.rowName &&
+         valueType == other.valueType;
+}
+
 string nameChange(string originName,NameType type)
 {
   string bigname = originName;
@@ -55,29 +90,60 @@ string nameChange(string originName,NameType type)
   return originName;
 }
 
-string _stripToken(const string &token)
+string _getReferenceTable(const string &propertyType)
 {
-  regex e("[^!-~ ]+");
-  return regex_replace (token,e,"");
+  size_t start = propertyType.find("ref<");
+  if (start == string::npos ||
+      (start > 0 && propertyType.compare(0, start, "set<") && propertyType.compare(0, start, "array<"))) {
+    return "";
+  }
+  size_t end = propertyType.find('>', start);
+  if (end == string::npos || end == start + 4 || propertyType.compare(end, string::npos, start > 0 ? ">>" : ">")) {
+    return "";
+  }
+  return propertyType.substr(start + 4, end - start - 4);
 }
 
-string _stripTokenToNum(const string &token)
+string _getElementType(const string &propertyType)
 {
-  regex e("[^0-9]+");
-  return regex_replace (token,e,"");
+  static const unordered_set<string> elementTypes({"int", "long", "double"});
+  size_t open = propertyType.find('<');
+  if (open == string::npos || propertyType.back() != '>' || !propertyType.compare(0, open, "ref")) {
+    return "";
+  }
+  string elementType = propertyType.substr(open + 1, propertyType.size() - open - 2);
+  if (!elementType.compare(0, 4, "ref<")) {
+    return _getReferenceTable(propertyType).empty() ? "" : "int";
+  }
+  return elementTypes.count(elementType) ? elementType : "";
 }
 
-ObjectiveType *_getPropertyType(const string &propertyType)
+ObjectiveType *_getPropertyType(ObjectiveArena &arena, const string &propertyType)
 {
+  // set<int>, array<double>... are sets and arrays with packed values,
+  // set<string> is the same as a plain set
+  size_t open = propertyType.find('<');
+  if (open != string::npos && !propertyType.compare(0, open, "ref")) {
+    // ref<item> is stored as the row index of the item
+    return _getReferenceTable(propertyType).empty() ? nullptr : arena.type("int");
+  }
+  if (open != string::npos) {
+    string collection = propertyType.substr(0, open);
+    if ((collection != "set" && collection != "array") ||
+        (_getElementType(propertyType).empty() && propertyType != collection + "<string>")) {
+      return nullptr;
+    }
+    return _getPropertyType(arena, collection);
+  }
   static const unordered_set<string> definedType({"int", "long", "double","BOOL", "NSInteger"});
   static const unordered_set<string> definedPointerType({"NSString", "NSSet", "NSArray"});
   static static_map definedMapType({{"string","NSString"}, {"id", "NSString"},{"groupId", "NSString"}, {"bool" , "BOOL"}, {"stringId", "NSString"}, {"set", "NSSet"}, {"array", "NSArray"}});
   if (definedMapType.count(propertyType)) {
-    return _getPropertyType(definedMapType.at(propertyType));
+    return _getPropertyType(arena, definedMapType.at(propertyType));
   } else if (definedType.count(propertyType)) {
-    return new ObjectiveType(propertyType);
+    return arena.type(propertyType);
   } else if (definedPointerType.count(propertyType)) {
-    return new ObjectiveType(propertyType, true);
+    return arena.type(propertyType, true);
   }
   return nullptr;
 }
@@ -98,6 +164,198 @@ string _getReadBufferByType(ObjectiveProperty *property)
   return result;
 }
 
+// the DataColumnKind DataDecoder reads the column with
+string _getColumnKind(ObjectiveProperty *property, const string &elementType)
+{
+  static static_map columnKinds({{"int", "DataColumnInt"},
+    {"BOOL", "DataColumnBool"},
+    {"long", "DataColumnLong"},
+    {"NSInteger", "DataColumnInteger"},
+    {"double", "DataColumnDouble"},
+    {"NSString", "DataColumnString"},
+    {"NSSet", "DataColumnSet"},
+    {"NSArray", "DataColumnArray"},
+  });
+  if (!elementType.empty()) {
+    return "DataColumn" + nameChange(elementType, Uppercase) + (property->type() == "NSSet" ? "Set" : "Array");
+  }
+  return columnKinds.at(property->type());
+}
+
+ObjectiveFile *generateDataDecoder(ObjectiveArena &arena)
+{
+  ObjectiveFile *decoderFile = arena.make<ObjectiveFile>("DataDecoder");
+  decoderFile->addImportHeaders("<objc/runtime.h>");
+  decoderFile->addImportHeaders("\"ByteBuffer.h\"");
+  decoderFile->addDeclaration("typedef NS_ENUM(uint8_t, DataColumnKind) {\n"
+                              "\tDataColumnInt,\n\tDataColumnBool,\n\tDataColumnLong,\n\tDataColumnInteger,\n\tDataColumnDouble,\n"
+                              "\tDataColumnString,\n\tDataColumnSet,\n\tDataColumnArray,\n"
+                              "\tDataColumnIntArray,\n\tDataColumnLongArray,\n\tDataColumnDoubleArray,\n"
+                              "\tDataColumnIntSet,\n\tDataColumnLongSet,\n\tDataColumnDoubleSet,\n"
+                              "};");
+  decoderFile->addDeclaration("// one ivar of a row class in the order game.dat stores it, ivar is filled in by resolveColumns\n"
+                              "typedef struct {\n"
+                              "\tconst char *name;\n"
+                              "\tDataColumnKind kind;\n"
+                              "\tIvar ivar;\n"
+                              "} DataColumn;");
+  ObjectiveClass *decoderClass = arena.make<ObjectiveClass>("DataDecoder");
+  decoderFile->addClass(decoderClass);
+  
+  ObjectiveFunction *resolveColumns = arena.make<ObjectiveFunction>("+(void)resolveColumns:(DataColumn *)columns count:(NSInteger)count ofClass:(Class)rowClass");
+  resolveColumns->addLines("for (NSInteger i = 0; i < count; ++i) {");
+  resolveColumns->addLines("\tcolumns[i].ivar = class_getInstanceVariable(rowClass, columns[i].name);");
+  resolveColumns->addLines("\tNSCAssert(columns[i].ivar != NULL, @\"%s has no ivar %s\", class_getName(rowClass), columns[i].name);");
+  resolveColumns->addLines("}");
+  decoderClass->addFunction(resolveColumns);
+  
+  ObjectiveFunction *decodeRow = arena.make<ObjectiveFunction>("+(void)decodeRow:(id)row buffer:(ByteBuffer *)buffer columns:(const DataColumn *)columns count:(NSInteger)count");
+  decodeRow->addLines("uint8_t *base = (uint8_t *)(__bridge void *)row;");
+  decodeRow->addLines("for (NSInteger i = 0; i < count; ++i) {");
+  decodeRow->addLines("\tconst DataColumn *column = &columns[i];");
+  decodeRow->addLines("\tvoid *field = base + ivar_getOffset(column->ivar);");
+  decodeRow->addLines("\tswitch (column->kind) {");
+  static const vector<pair<string, string>> scalarLines({{"DataColumnInt", "*(int *)field = [buffer readInt];"},
+    {"DataColumnBool", "*(BOOL *)field = [buffer readInt] != 0;"},
+    {"DataColumnLong", "*(long *)field = [buffer readLong];"},
+    {"DataColumnInteger", "*(NSInteger *)field = [buffer readLong];"},
+    {"DataColumnDouble", "*(double *)field = [buffer readDouble];"},
+    {"DataColumnString", "object_setIvar(row, column->ivar, [buffer readString]);"},
+    {"DataColumnSet", "object_setIvar(row, column->ivar, [buffer readSet]);"},
+    {"DataColumnArray", "object_setIvar(row, column->ivar, [buffer readArray]);"},
+  });
+  for (const pair<string, string> &scalar : scalarLines) {
+    decodeRow->addLines("\t\tcase " + scalar.first + ":");
+    decodeRow->addLines("\t\t\t" + scalar.second);
+    decodeRow->addLines("\t\t\tbreak;");
+  }
+  decodeRow->addLines("\t\tdefault: {");
+  decodeRow->addLines("\t\t\t// typed sets and arrays, the count and then the packed values");
+  decodeRow->addLines("\t\t\tNSInteger itemCount = [buffer readLong];");
+  decodeRow->addLines("\t\t\tNSMutableArray *items = [NSMutableArray arrayWithCapacity:itemCount];");
+  decodeRow->addLines("\t\t\tfor (NSInteger item = 0; item < itemCount; ++item) {");
+  decodeRow->addLines("\t\t\t\tif (column->kind == DataColumnIntArray || column->kind == DataColumnIntSet) {");
+  decodeRow->addLines("\t\t\t\t\t[items addObject:@([buffer readInt])];");
+  decodeRow->addLines("\t\t\t\t} else if (column->kind == DataColumnLongArray || column->kind == DataColumnLongSet) {");
+  decodeRow->addLines("\t\t\t\t\t[items addObject:@([buffer readLong])];");
+  decodeRow->addLines("\t\t\t\t} else {");
+  decodeRow->addLines("\t\t\t\t\t[items addObject:@([buffer readDouble])];");
+  decodeRow->addLines("\t\t\t\t}");
+  decodeRow->addLines("\t\t\t}");
+  decodeRow->addLines("\t\t\tobject_setIvar(row, column->ivar, column->kind >= DataColumnIntSet ? [NSSet setWithArray:items] : items);");
+  decodeRow->addLines("\t\t\tbreak;");
+  decodeRow->addLines("\t\t}");
+  decodeRow->addLines("\t}");
+  decodeRow->addLines("}");
+  decoderClass->addFunction(decodeRow);
+  return decoderFile;
+}
+
+string _getColumnarReadLine(ObjectiveProperty *property)
+{
+  return "\t_" + property->name() + " = [dic " + property->name() + "AtIndex:index];";
+}
+
+string encodeTableSchema(const TableSchema &schema, const ConvertOptions &options)
+{
+  bb::ByteBuffer buffer(0);
+  buffer.put(kSchemaVersion);
+  if (schema.isMatrix) {
+    buffer.put((uint8_t)SchemaMatrix);
+    buffer.put((uint8_t)0);
+    buffer.putString(schema.functionName);
+    buffer.putString(schema.colName);
+    buffer.putString(schema.rowName);
+    buffer.putString(schema.valueType);
+    return string((const char *)buffer.data(), buffer.size());
+  }
+  buffer.put((uint8_t)(schema.isGroup ? SchemaGroupTable : SchemaTable));
+  buffer.put((uint8_t)((options.columnar ? SchemaColumnar : 0) | (options.embedStrings ? SchemaEmbeddedStrings : 0) |
+                      (options.columnar && options.packNumbers ? SchemaPackedNumbers : 0)));
+  buffer.putString(schema.key);
+  // the same columns in the same order the converter stores them
+  static const unordered_map<string, ColumnEncoding> scalarEncodings({{"int", Int32Encoding}, {"BOOL", Int32Encoding},
+    {"long", Int64Encoding}, {"NSInteger", Int64Encoding}, {"double", DoubleEncoding}, {"NSString", StringEncoding}});
+  static const unordered_map<string, ColumnEncoding> listEncodings({{"", StringListEncoding},
+    {"int", Int32ListEncoding}, {"long", Int64ListEncoding}, {"double", DoubleListEncoding}});
+  ObjectiveArena arena;
+  bb::ByteBuffer columns(0);
+  uint32_t columnCount = 0;
+  vector<string> embeddedStrings;
+  for (int i = 0; i < schema.propertyTypeList.size(); ++i) {
+    const string &propertyType = schema.propertyTypeList[i];
+    ObjectiveType *objectiveType = _getPropertyType(arena, propertyType);
+    if (objectiveType == nullptr) {
+      if (options.embedStrings && !propertyType.compare(0, 4, "name") && propertyType.size() > 5) {
+        embeddedStrings.push_back(propertyType.substr(5));
+      }
+      continue;
+    }
+    bool isList = objectiveType->type() == "NSSet" || objectiveType->type() == "NSArray";
+    ColumnEncoding encoding = isList ? listEncodings.at(_getElementType(propertyType)) : scalarEncodings.at(objectiveType->type());
+    columns.putString(schema.propertyList[i]);
+    columns.putString(propertyType);
+    columns.put((uint8_t)encoding);
+    columnCount++;
+  }
+  buffer.putInt(columnCount);
+  buffer.putBytes(const_cast<uint8_t *>(columns.data()), columns.size());
+  buffer.putInt((uint32_t)embeddedStrings.size());
+  for (const string &name : embeddedStrings) {
+    buffer.putString(name);
+  }
+  return string((const char *)buffer.data(), buffer.size());
+}
+
+bool readFileContent(const string &path, string &content)
+{
+  ProfileScope readScope(PhaseRead, "read");
+  // during a build the file is usually read already, then this only waits for it
+  if (SourceIngest::takeActive(path, content)) {
+    return true;
+  }
+  ifstream indata(path, ifstream::binary);
+  if (!indata) {
+    content.clear();
+    return false;
+  }
+  indata.seekg(0, ios::end);
+  content.resize((size_t)indata.tellg());
+  indata.seekg(0, ios::beg);
+  indata.read(&content[0], content.size());
+  return true;
+}
+
+bool nextLine(const string &content, size_t &position, string &line, char delimiter)
+{
+  if (position >= content.size()) {
+    return false;
+  }
+  size_t end = content.find(delimiter, position);
+  if (end == string::npos) {
+    end = content.size();
+  }
+  line.assign(content, position, end - position);
+  position = end + 1;
+  return true;
+}
+
+vector<string> readTypeRow(const string &path)
+{
+  vector<string> types;
+  ifstream indata(path, ifstream::binary);
+  string line;
+  if (!getline(indata, line, '\r') || !getline(indata, line, '\r')) {
+    return types;
+  }
+  line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
+  splitCells(line, CSV_SEPARATOR_CHARS, types);
+  for (string &type : types) {
+    sanitizeCell(type, HeaderText);
+  }
+  return types;
+}
+
 vector<string> getCSVFileList(const string &path) {
   vector<string> result;
   string postFix = CSV_EXTENSION;
@@ -124,7 +382,7 @@ vector<string> getCSVFileList(const string &path) {
   return result;
 }
 
-void _saveBuffer(unique_ptr<bb::ByteBuffer> &buffer, ObjectiveType *type, string &token)
+void _saveBuffer(unique_ptr<bb::ByteBuffer> &buffer, ObjectiveType *type, const string &token)
 {
   if (type->type() == "int") {
     buffer->putInt(stoi(token));
@@ -138,7 +396,8 @@ void _saveBuffer(unique_ptr<bb::ByteBuffer> &buffer, ObjectiveType *type, string
     buffer->putString(token);
   } else if (type->type() == "NSSet" || type->type() == "set" ||
              type->type() == "NSArray" || type->type() == "array") {
-    vector<string> sets = splitStr(token, ";");
+    vector<string> sets;
+    splitCells(token, ";", sets);
     buffer->putLong(sets.size());
     for (int i = 0; i < sets.size(); ++i) {
       buffer->putString(sets[i]);
@@ -148,10 +407,90 @@ void _saveBuffer(unique_ptr<bb::ByteBuffer> &buffer, ObjectiveType *type, string
   }
 }
 
-ObjectiveClass *_prepareDicClass(const string &name, const string &key, bool isGroup)
+void _addEmbeddedStringLines(ObjectiveFunction *initWithByteBuffer, const vector<string> &embeddedStrings, const string &amount)
+{
+  // the embedded strings follow the rows, one column after the other
+  for (const string &stringName : embeddedStrings) {
+    initWithByteBuffer->addLines("\tNSMutableArray *" + stringName + "Strings = [NSMutableArray arrayWithCapacity:" + amount + "];");
+    initWithByteBuffer->addLines("\tfor (int i = 0; i < " + amount + "; ++i) {");
+    initWithByteBuffer->addLines("\t\t[" + stringName + "Strings addObject:[buffer readString]];");
+    initWithByteBuffer->addLines("\t}");
+    initWithByteBuffer->addLines("\t_" + stringName + "Strings = " + stringName + "Strings;");
+  }
+}
+
+void _saveTypedCollection(unique_ptr<bb::ByteBuffer> &buffer, const string &elementType, const string &token)
 {
-  ObjectiveClass *objectiveDic = new ObjectiveClass(nameChange(name, DataDicDeclare));
-  ObjectiveFunction *initWithByteBuffer = new ObjectiveFunction("-(instancetype)initWithByteBuffer:(ByteBuffer *)buffer");
+  vector<string> items;
+  splitCells(token, ";", items);
+  // an empty cell is an empty collection, not one empty string
+  if (items.size() == 1 && items[0].empty()) {
+    items.clear();
+  }
+  buffer->putLong(items.size());
+  for (const string &item : items) {
+    if (elementType == "int") {
+      buffer->putInt(stoi(item));
+    } else if (elementType == "long") {
+      buffer->putLong(stoll(item));
+    } else {
+      buffer->putDouble(stod(item));
+    }
+  }
+}
+
+void _addTypedCollectionReadLines(ObjectiveFunction *initWithByteBuffer, ObjectiveProperty *property, const string &elementType)
+{
+  static static_map readFunctions({{"int", "readInt"}, {"long", "readLong"}, {"double", "readDouble"}});
+  string name = property->name();
+  initWithByteBuffer->addLines("\tNSInteger " + name + "Count = [buffer readLong];");
+  initWithByteBuffer->addLines("\tNSMutableArray *" + name + " = [NSMutableArray arrayWithCapacity:" + name + "Count];");
+  initWithByteBuffer->addLines("\tfor (NSInteger i = 0; i < " + name + "Count; ++i) {");
+  initWithByteBuffer->addLines("\t\t[" + name + " addObject:@([buffer " + readFunctions.at(elementType) + "])];");
+  initWithByteBuffer->addLines("\t}");
+  if (property->type() == "NSSet") {
+    initWithByteBuffer->addLines("\t_" + name + " = [NSSet setWithArray:" + name + "];");
+  } else {
+    initWithByteBuffer->addLines("\t_" + name + " = " + name + ";");
+  }
+}
+
+// the ref<item> column stores the row index in itemIndex, the getter named
+// after the column returns the row of the item table without a lookup by id
+void _addReferenceGetter(ObjectiveArena &arena, ObjectiveFile *objectiveFile, ObjectiveClass *objectiveData,
+                         ObjectiveProperty *indexProperty, const string &name, const string &table)
+{
+  string dataDeclare = nameChange(table, DataDeclare);
+  string dicDeclare = nameChange(table, DataDicDeclare);
+  string getDic = "[[DataManager sharedDataManager] get" + dicDeclare + "]";
+  string getDataAtIndex = "get" + nameChange(table, Uppercase) + "AtIndex:";
+  string indexIvar = "_" + indexProperty->name();
+  objectiveFile->addForwardClass(dataDeclare);
+  objectiveFile->addImpImportHeaders("\"DataManager.h\"");
+  ObjectiveFunction *getter;
+  if (indexProperty->type() == "int") {
+    getter = arena.make<ObjectiveFunction>("-(" + dataDeclare + " *)" + name);
+    getter->addLines("if (" + indexIvar + " < 0) {");
+    getter->addLines("\treturn nil;");
+    getter->addLines("}");
+    getter->addLines("return [" + getDic + " " + getDataAtIndex + indexIvar + "];");
+  } else {
+    getter = arena.make<ObjectiveFunction>("-(" + indexProperty->type() + " *)" + name);
+    getter->addLines(dicDeclare + " *dic = " + getDic + ";");
+    getter->addLines("NSMutableArray *rows = [NSMutableArray arrayWithCapacity:" + indexIvar + ".count];");
+    getter->addLines("for (NSNumber *index in " + indexIvar + ") {");
+    getter->addLines("\t[rows addObject:[dic " + getDataAtIndex + "index.integerValue]];");
+    getter->addLines("}");
+    getter->addLines(indexProperty->type() == "NSSet" ? "return [NSSet setWithArray:rows];" : "return rows;");
+  }
+  objectiveData->addFunction(getter);
+}
+
+ObjectiveClass *_prepareDicClass(ObjectiveArena &arena, const string &name, const string &key, bool isGroup,
+                                 bool isReferenced, const vector<string> &embeddedStrings)
+{
+  ObjectiveClass *objectiveDic = arena.make<ObjectiveClass>(nameChange(name, DataDicDeclare));
+  ObjectiveFunction *initWithByteBuffer = arena.make<ObjectiveFunction>("-(instancetype)initWithByteBuffer:(ByteBuffer *)buffer");
   string dataDeclare = nameChange(name, DataDeclare);
   initWithByteBuffer->addLines("self = [self init];");
   initWithByteBuffer->addLines("if (self) {");
@@ -160,9 +499,16 @@ ObjectiveClass *_prepareDicClass(const string &name, const string &key, bool isG
     initWithByteBuffer->addLines("\t_groupData = [NSMutableDictionary new];");
   } else {
     initWithByteBuffer->addLines("\t_data = [NSMutableDictionary new];");
+    if (isReferenced) {
+      initWithByteBuffer->addLines("\t_rows = [NSMutableArray arrayWithCapacity:amount];");
+    }
   }
   initWithByteBuffer->addLines("\tfor (int i = 0; i < amount; ++i) {");
-  initWithByteBuffer->addLines("\t\t" + dataDeclare + " *data = [[" + dataDeclare + " alloc] initWithByteBuffer:buffer];");
+  if (embeddedStrings.size() > 0) {
+    initWithByteBuffer->addLines("\t\t" + dataDeclare + " *data = [[" + dataDeclare + " alloc] initWithByteBuffer:buffer rowIndex:i];");
+  } else {
+    initWithByteBuffer->addLines("\t\t" + dataDeclare + " *data = [[" + dataDeclare + " alloc] initWithByteBuffer:buffer];");
+  }
   if (isGroup) {
     initWithByteBuffer->addLines("\t\tif ([_groupData objectForKey:data." + key + "] == nil) {");
     initWithByteBuffer->addLines("\t\t\t[_groupData setObject:[NSMutableArray new] forKey:data." + key + "];");
@@ -170,8 +516,12 @@ ObjectiveClass *_prepareDicClass(const string &name, const string &key, bool isG
     initWithByteBuffer->addLines("[[_groupData objectForKey:data."+ key + "] addObject:data];");
   } else {
     initWithByteBuffer->addLines("\t\t[_data setObject:data forKey:data." + key +"];");
+    if (isReferenced) {
+      initWithByteBuffer->addLines("\t\t[_rows addObject:data];");
+    }
   }
   initWithByteBuffer->addLines("\t}");
+  _addEmbeddedStringLines(initWithByteBuffer, embeddedStrings, "amount");
   initWithByteBuffer->addLines("}");
   initWithByteBuffer->addLines("return self;");
   objectiveDic->addFunction(initWithByteBuffer);
@@ -179,95 +529,397 @@ ObjectiveClass *_prepareDicClass(const string &name, const string &key, bool isG
   string dataUpper = nameChange(name, Uppercase);
   ObjectiveFunction *getDataById;
   if (isGroup) {
-    getDataById = new ObjectiveFunction("-(NSArray *)get" + dataUpper + "GroupByGroupId:(NSString *)groupId");
+    getDataById = arena.make<ObjectiveFunction>("-(NSArray *)get" + dataUpper + "GroupByGroupId:(NSString *)groupId");
     getDataById->addLines("return [_groupData objectForKey:groupId];");
-    ObjectiveProperty *groupData = new ObjectiveProperty("_groupData", new ObjectiveType("NSMutableDictionary", true));
+    ObjectiveProperty *groupData = arena.make<ObjectiveProperty>("_groupData", arena.type("NSMutableDictionary", true));
     objectiveDic->addImpProperty(groupData);
   } else {
-    getDataById = new ObjectiveFunction("-(" + dataDeclare + " *)get" + dataUpper + "ById:(NSString *)" + key);
+    getDataById = arena.make<ObjectiveFunction>("-(" + dataDeclare + " *)get" + dataUpper + "ById:(NSString *)" + key);
     getDataById->addLines("return [_data objectForKey:" + key + "];");
-    ObjectiveFunction *getDictionary = new ObjectiveFunction("-(NSDictionary *)getDictionary");
+    ObjectiveFunction *getDictionary = arena.make<ObjectiveFunction>("-(NSDictionary *)getDictionary");
     getDictionary->addLines("return _data;");
     objectiveDic->addFunction(getDictionary);
-    ObjectiveProperty *data = new ObjectiveProperty("_data", new ObjectiveType("NSMutableDictionary", true));
+    ObjectiveProperty *data = arena.make<ObjectiveProperty>("_data", arena.type("NSMutableDictionary", true));
     objectiveDic->addImpProperty(data);
   }
+  if (!isGroup && isReferenced) {
+    // rows in file order, ref<table> columns of other tables hold these indices
+    objectiveDic->addImpProperty(arena.make<ObjectiveProperty>("_rows", arena.type("NSMutableArray", true)));
+    ObjectiveFunction *count = arena.make<ObjectiveFunction>("-(NSInteger)count");
+    count->addLines("return _rows.count;");
+    objectiveDic->addFunction(count);
+    ObjectiveFunction *getDataAtIndex = arena.make<ObjectiveFunction>("-(" + dataDeclare + " *)get" + dataUpper + "AtIndex:(NSInteger)index");
+    getDataAtIndex->addLines("return _rows[index];");
+    objectiveDic->addFunction(getDataAtIndex);
+  }
   objectiveDic->addFunction(getDataById);
   
   return objectiveDic;
 }
 
-ObjectiveFile* convertCSVToObjectiveClass(const string &basePath,
+// reads one column written by packNumbers, the function is named after the Dic
+// because it lands in the header next to the classes
+StaticCPPFunction *_makeUnpackFunction(ObjectiveArena &arena, const string &functionName)
+{
+  StaticCPPFunction *unpack = arena.make<StaticCPPFunction>("static inline void " + functionName + "(ByteBuffer *buffer, int64_t *values, NSInteger count, BOOL wide)");
+  unpack->addLines("int packing = [buffer readInt];");
+  unpack->addLines("if (packing == " + to_string(PlainNumbers) + ") {");
+  unpack->addLines("	for (NSInteger i = 0; i < count; ++i) {");
+  unpack->addLines("		values[i] = wide ? [buffer readLong] : [buffer readInt];");
+  unpack->addLines("	}");
+  unpack->addLines("} else if (packing == " + to_string(ConstantNumbers) + ") {");
+  unpack->addLines("	int64_t value = [buffer readLong];");
+  unpack->addLines("	for (NSInteger i = 0; i < count; ++i) {");
+  unpack->addLines("		values[i] = value;");
+  unpack->addLines("	}");
+  unpack->addLines("} else if (packing == " + to_string(RunNumbers) + ") {");
+  unpack->addLines("	int runs = [buffer readInt];");
+  unpack->addLines("	NSInteger row = 0;");
+  unpack->addLines("	for (int run = 0; run < runs; ++run) {");
+  unpack->addLines("		int end = [buffer readInt];");
+  unpack->addLines("		int64_t value = [buffer readLong];");
+  unpack->addLines("		for (; row < end; ++row) {");
+  unpack->addLines("			values[row] = value;");
+  unpack->addLines("		}");
+  unpack->addLines("	}");
+  unpack->addLines("} else {");
+  unpack->addLines("	BOOL delta = packing == " + to_string(DeltaNumbers) + " && count > 0;");
+  unpack->addLines("	int64_t first = packing == " + to_string(DeltaNumbers) + " ? [buffer readLong] : 0;");
+  unpack->addLines("	uint64_t reference = [buffer readLong];");
+  unpack->addLines("	int bits = [buffer readInt];");
+  unpack->addLines("	NSInteger packed = delta ? count - 1 : count;");
+  unpack->addLines("	NSInteger wordCount = (packed * bits + 63) / 64;");
+  unpack->addLines("	uint64_t *words = malloc((wordCount + 1) * sizeof(uint64_t));");
+  unpack->addLines("	for (NSInteger i = 0; i < wordCount; ++i) {");
+  unpack->addLines("		words[i] = [buffer readLong];");
+  unpack->addLines("	}");
+  unpack->addLines("	uint64_t mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;");
+  unpack->addLines("	int64_t *target = delta ? values + 1 : values;");
+  unpack->addLines("	for (NSInteger i = 0; i < packed; ++i) {");
+  unpack->addLines("		NSInteger bit = i * bits;");
+  unpack->addLines("		uint64_t value = words[bit / 64] >> (bit % 64);");
+  unpack->addLines("		if (bit % 64 + bits > 64) {");
+  unpack->addLines("			value |= words[bit / 64 + 1] << (64 - bit % 64);");
+  unpack->addLines("		}");
+  unpack->addLines("		target[i] = (int64_t)(reference + (value & mask));");
+  unpack->addLines("	}");
+  unpack->addLines("	free(words);");
+  unpack->addLines("	if (delta) {");
+  unpack->addLines("		values[0] = first;");
+  unpack->addLines("		for (NSInteger i = 1; i < count; ++i) {");
+  unpack->addLines("			values[i] = (int64_t)((uint64_t)values[i - 1] + (uint64_t)values[i]);");
+  unpack->addLines("		}");
+  unpack->addLines("	}");
+  unpack->addLines("}");
+  return unpack;
+}
+
+ObjectiveClass *_prepareColumnarDicClass(ObjectiveArena &arena, const string &name, const string &key, bool isGroup,
+                                         const vector<ObjectiveProperty *> &properties,
+                                         const vector<string> &elementTypes,
+                                         const vector<bool> &packedProperties,
+                                         const vector<string> &embeddedStrings)
+{
+  static static_map readFunctions({{"int", "readInt"}, {"BOOL", "readInt"}, {"long", "readLong"}, {"NSInteger", "readLong"}, {"double", "readDouble"}});
+  ObjectiveClass *objectiveDic = arena.make<ObjectiveClass>(nameChange(name, DataDicDeclare));
+  string dataDeclare = nameChange(name, DataDeclare);
+  string dataUpper = nameChange(name, Uppercase);
+  string getDataAtIndex = "get" + dataUpper + "AtIndex";
+  objectiveDic->addImpProperty(arena.make<ObjectiveProperty>("_count", arena.type("NSInteger")));
+  
+  ObjectiveFunction *initWithByteBuffer = arena.make<ObjectiveFunction>("-(instancetype)initWithByteBuffer:(ByteBuffer *)buffer");
+  initWithByteBuffer->addLines("self = [self init];");
+  initWithByteBuffer->addLines("if (self) {");
+  initWithByteBuffer->addLines("\t_count = [buffer readInt];");
+  bool hasPackedColumns = find(packedProperties.begin(), packedProperties.end(), true) != packedProperties.end();
+  if (hasPackedColumns) {
+    initWithByteBuffer->addLines("\tint64_t *packed = malloc(MAX(_count, 1) * sizeof(int64_t));");
+  }
+  ObjectiveFunction *dealloc = arena.make<ObjectiveFunction>("-(void)dealloc");
+  vector<ObjectiveFunction *> columnGetters;
+  for (int column = 0; column < properties.size(); ++column) {
+    ObjectiveProperty *property = properties[column];
+    const string &elementType = elementTypes[column];
+    string propertyName = property->name();
+    string getter = "-(" + arena.type(property->type(), ColumnarTableWriter::isTextType(property->type()))->str() + ")" +
+                    propertyName + "AtIndex:(NSInteger)index";
+    ObjectiveFunction *getColumn = arena.make<ObjectiveFunction>(getter);
+    // typed collections can also be read in place without NSNumbers
+    ObjectiveFunction *getValues = nullptr;
+    if (!elementType.empty()) {
+      // element offsets per row and all values of the column in one block
+      string offsets = "_" + propertyName + "Offsets";
+      string values = "_" + propertyName + "Values";
+      objectiveDic->addImpProperty(arena.make<ObjectiveProperty>(offsets, arena.type("int", true)));
+      objectiveDic->addImpProperty(arena.make<ObjectiveProperty>(values, arena.type(elementType, true)));
+      initWithByteBuffer->addLines("\t" + offsets + " = malloc((_count + 1) * sizeof(int));");
+      initWithByteBuffer->addLines("\tfor (NSInteger i = 0; i <= _count; ++i) {");
+      initWithByteBuffer->addLines("\t\t" + offsets + "[i] = [buffer readInt];");
+      initWithByteBuffer->addLines("\t}");
+      initWithByteBuffer->addLines("\t" + values + " = malloc(MAX(" + offsets + "[_count], 1) * sizeof(" + elementType + "));");
+      initWithByteBuffer->addLines("\tfor (NSInteger i = 0; i < " + offsets + "[_count]; ++i) {");
+      initWithByteBuffer->addLines("\t\t" + values + "[i] = [buffer " + readFunctions.at(elementType) + "];");
+      initWithByteBuffer->addLines("\t}");
+      dealloc->addLines("free(" + offsets + ");");
+      dealloc->addLines("free(" + values + ");");
+      getColumn->addLines("NSMutableArray *items = [NSMutableArray arrayWithCapacity:" + offsets + "[index + 1] - " + offsets + "[index]];");
+      getColumn->addLines("for (int i = " + offsets + "[index]; i < " + offsets + "[index + 1]; ++i) {");
+      getColumn->addLines("\t[items addObject:@(" + values + "[i])];");
+      getColumn->addLines("}");
+      getColumn->addLines(property->type() == "NSSet" ? "return [NSSet setWithArray:items];" : "return items;");
+      getValues = arena.make<ObjectiveFunction>("-(const " + elementType + " *)" + propertyName + "ValuesAtIndex:(NSInteger)index count:(NSInteger *)count");
+      getValues->addLines("*count = " + offsets + "[index + 1] - " + offsets + "[index];");
+      getValues->addLines("return " + values + " + " + offsets + "[index];");
+    } else if (ColumnarTableWriter::isTextType(property->type())) {
+      string text = "_" + propertyName + "Text";
+      string offsets = "_" + propertyName + "Offsets";
+      objectiveDic->addImpProperty(arena.make<ObjectiveProperty>(text, arena.type("NSString", true)));
+      objectiveDic->addImpProperty(arena.make<ObjectiveProperty>(offsets, arena.type("int", true)));
+      initWithByteBuffer->addLines("\t" + text + " = [buffer readString];");
+      initWithByteBuffer->addLines("\t" + offsets + " = malloc((_count + 1) * sizeof(int));");
+      initWithByteBuffer->addLines("\tfor (NSInteger i = 0; i <= _count; ++i) {");
+      initWithByteBuffer->addLines("\t\t" + offsets + "[i] = [buffer readInt];");
+      initWithByteBuffer->addLines("\t}");
+      dealloc->addLines("free(" + offsets + ");");
+      string range = "NSMakeRange(" + offsets + "[index], " + offsets + "[index + 1] - " + offsets + "[index])";
+      if (property->type() == "NSString") {
+        getColumn->addLines("return [" + text + " substringWithRange:" + range + "];");
+      } else {
+        getColumn->addLines("NSString *text = [" + text + " substringWithRange:" + range + "];");
+        if (property->type() == "NSSet") {
+          getColumn->addLines("return [NSSet setWithArray:[text componentsSeparatedByString:@\";\"]];");
+        } else {
+          getColumn->addLines("return [text componentsSeparatedByString:@\";\"];");
+        }
+      }
+    } else {
+      string values = "_" + propertyName + "Values";
+      objectiveDic->addImpProperty(arena.make<ObjectiveProperty>(values, arena.type(property->type(), true)));
+      initWithByteBuffer->addLines("\t" + values + " = malloc(MAX(_count, 1) * sizeof(" + property->type() + "));");
+      if (packedProperties[column]) {
+        bool wide = property->type() == "long" || property->type() == "NSInteger";
+        initWithByteBuffer->addLines("\t" + nameChange(name, DataDicDeclare) + "UnpackNumbers(buffer, packed, _count, " + (wide ? "YES" : "NO") + ");");
+        initWithByteBuffer->addLines("\tfor (NSInteger i = 0; i < _count; ++i) {");
+        initWithByteBuffer->addLines("\t\t" + values + "[i] = (" + property->type() + ")packed[i];");
+        initWithByteBuffer->addLines("\t}");
+      } else {
+        initWithByteBuffer->addLines("\tfor (NSInteger i = 0; i < _count; ++i) {");
+        initWithByteBuffer->addLines("\t\t" + values + "[i] = [buffer " + readFunctions.at(property->type()) + "];");
+        initWithByteBuffer->addLines("\t}");
+      }
+      dealloc->addLines("free(" + values + ");");
+      getColumn->addLines("return " + values + "[index];");
+    }
+    columnGetters.push_back(getColumn);
+    if (getValues != nullptr) {
+      columnGetters.push_back(getValues);
+    }
+  }
+  if (hasPackedColumns) {
+    initWithByteBuffer->addLines("\tfree(packed);");
+  }
+  _addEmbeddedStringLines(initWithByteBuffer, embeddedStrings, "_count");
+  // rows are created on first access, NSNull marks the ones nobody asked for yet
+  objectiveDic->addImpProperty(arena.make<ObjectiveProperty>("_rows", arena.type("NSMutableArray", true)));
+  initWithByteBuffer->addLines("\t_rows = [NSMutableArray arrayWithCapacity:_count];");
+  initWithByteBuffer->addLines("\tfor (NSInteger i = 0; i < _count; ++i) {");
+  initWithByteBuffer->addLines("\t\t[_rows addObject:[NSNull null]];");
+  initWithByteBuffer->addLines("\t}");
+  initWithByteBuffer->addLines("}");
+  initWithByteBuffer->addLines("return self;");
+  objectiveDic->addFunction(initWithByteBuffer);
+  objectiveDic->addFunction(dealloc);
+  
+  ObjectiveFunction *count = arena.make<ObjectiveFunction>("-(NSInteger)count");
+  count->addLines("return _count;");
+  objectiveDic->addFunction(count);
+  for (ObjectiveFunction *getColumn : columnGetters) {
+    objectiveDic->addFunction(getColumn);
+  }
+  
+  ObjectiveFunction *getDataAtIndexFunction = arena.make<ObjectiveFunction>("-(" + dataDeclare + " *)" + getDataAtIndex + ":(NSInteger)index");
+  getDataAtIndexFunction->addLines("id data = _rows[index];");
+  getDataAtIndexFunction->addLines("if (data == [NSNull null]) {");
+  getDataAtIndexFunction->addLines("\tdata = [[" + dataDeclare + " alloc] initWithDic:self index:index];");
+  getDataAtIndexFunction->addLines("\t_rows[index] = data;");
+  getDataAtIndexFunction->addLines("}");
+  getDataAtIndexFunction->addLines("return data;");
+  objectiveDic->addFunction(getDataAtIndexFunction);
+  
+  if (isGroup) {
+    objectiveDic->addImpProperty(arena.make<ObjectiveProperty>("_groupIndexes", arena.type("NSMutableDictionary", true)));
+    ObjectiveFunction *getGroup = arena.make<ObjectiveFunction>("-(NSArray *)get" + dataUpper + "GroupByGroupId:(NSString *)groupId");
+    getGroup->addLines("if (_groupIndexes == nil) {");
+    getGroup->addLines("\t_groupIndexes = [NSMutableDictionary new];");
+    getGroup->addLines("\tfor (NSInteger i = 0; i < _count; ++i) {");
+    getGroup->addLines("\t\tNSString *key = [self " + key + "AtIndex:i];");
+    getGroup->addLines("\t\tNSMutableArray *indexes = _groupIndexes[key];");
+    getGroup->addLines("\t\tif (indexes == nil) {");
+    getGroup->addLines("\t\t\tindexes = [NSMutableArray new];");
+    getGroup->addLines("\t\t\t_groupIndexes[key] = indexes;");
+    getGroup->addLines("\t\t}");
+    getGroup->addLines("\t\t[indexes addObject:@(i)];");
+    getGroup->addLines("\t}");
+    getGroup->addLines("}");
+    getGroup->addLines("NSArray *indexes = _groupIndexes[groupId];");
+    getGroup->addLines("if (indexes == nil) {");
+    getGroup->addLines("\treturn nil;");
+    getGroup->addLines("}");
+    getGroup->addLines("NSMutableArray *group = [NSMutableArray arrayWithCapacity:indexes.count];");
+    getGroup->addLines("for (NSNumber *index in indexes) {");
+    getGroup->addLines("\t[group addObject:[self " + getDataAtIndex + ":index.integerValue]];");
+    getGroup->addLines("}");
+    getGroup->addLines("return group;");
+    objectiveDic->addFunction(getGroup);
+  } else {
+    objectiveDic->addImpProperty(arena.make<ObjectiveProperty>("_indexById", arena.type("NSMutableDictionary", true)));
+    ObjectiveFunction *indexOf = arena.make<ObjectiveFunction>("-(NSInteger)indexOf" + nameChange(key, Uppercase) + ":(NSString *)" + key);
+    indexOf->addLines("if (_indexById == nil) {");
+    indexOf->addLines("\t_indexById = [NSMutableDictionary dictionaryWithCapacity:_count];");
+    indexOf->addLines("\tfor (NSInteger i = 0; i < _count; ++i) {");
+    indexOf->addLines("\t\t_indexById[[self " + key + "AtIndex:i]] = @(i);");
+    indexOf->addLines("\t}");
+    indexOf->addLines("}");
+    indexOf->addLines("NSNumber *index = _indexById[" + key + "];");
+    indexOf->addLines("return index == nil ? -1 : index.integerValue;");
+    objectiveDic->addFunction(indexOf);
+    
+    ObjectiveFunction *getDictionary = arena.make<ObjectiveFunction>("-(NSDictionary *)getDictionary");
+    getDictionary->addLines("NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:_count];");
+    getDictionary->addLines("for (NSInteger i = 0; i < _count; ++i) {");
+    getDictionary->addLines("\t" + dataDeclare + " *data = [self " + getDataAtIndex + ":i];");
+    getDictionary->addLines("\tdictionary[data." + key + "] = data;");
+    getDictionary->addLines("}");
+    getDictionary->addLines("return dictionary;");
+    objectiveDic->addFunction(getDictionary);
+    
+    ObjectiveFunction *getDataById = arena.make<ObjectiveFunction>("-(" + dataDeclare + " *)get" + dataUpper + "ById:(NSString *)" + key);
+    getDataById->addLines("NSInteger index = [self indexOf" + nameChange(key, Uppercase) + ":" + key + "];");
+    getDataById->addLines("return index < 0 ? nil : [self " + getDataAtIndex + ":index];");
+    objectiveDic->addFunction(getDataById);
+  }
+  return objectiveDic;
+}
+
+ObjectiveFile* convertCSVToObjectiveClass(ObjectiveArena &arena,
+                                          const string &basePath,
                                           const string &fileName,
-                                          const string &savePath,
-                                          map<string, string> &localizedMap,
-                                          unique_ptr<bb::ByteBuffer> &buffer)
+                                          LocalizedStringTable &localizedMap,
+                                          unique_ptr<bb::ByteBuffer> &buffer,
+                                          Validator &validator,
+                                          const ConvertOptions &options,
+                                          TableSchema *schema,
+                                          TableLinks *links)
 {
   string name = fileName.substr(0, fileName.length() - CSV_EXTENSION.length());
-  cout << name << endl;
 
-  ObjectiveFile *objectiveFile = new ObjectiveFile(nameChange(name, DataDeclare));
-  ObjectiveClass *objectiveData = new ObjectiveClass(nameChange(name, DataDeclare));
+  ObjectiveFile *objectiveFile = arena.make<ObjectiveFile>(nameChange(name, DataDeclare));
+  ObjectiveClass *objectiveData = arena.make<ObjectiveClass>(nameChange(name, DataDeclare));
   objectiveFile->addClass(objectiveData);
   objectiveFile->addImportHeaders("\"ByteBuffer.h\"");
-  ObjectiveType initType("instancetype");
-  ObjectiveType bufferType("ByteBuffer", true);
-  ObjectiveFunction *initWithByteBufferFunction = new ObjectiveFunction("initWithByteBuffer",
-                                                                        initType,
-                                                                        vector<string>(),
-                                                                        vector<string>({"buffer"}),
-                                                                        vector<ObjectiveType>({bufferType}));
+  ObjectiveFunction *initDataFunction;
+  if (options.columnar) {
+    // rows are cut out of the columns the Dic holds
+    string dicDeclare = nameChange(name, DataDicDeclare);
+    objectiveFile->addForwardClass(dicDeclare);
+    initDataFunction = arena.make<ObjectiveFunction>("-(instancetype)initWithDic:(" + dicDeclare + " *)dic index:(NSInteger)index");
+  } else {
+    ObjectiveType initType("instancetype");
+    ObjectiveType bufferType("ByteBuffer", true);
+    initDataFunction = arena.make<ObjectiveFunction>("initWithByteBuffer",
+                                                     initType,
+                                                     vector<string>(),
+                                                     vector<string>({"buffer"}),
+                                                     vector<ObjectiveType>({bufferType}));
+  }
   
-  initWithByteBufferFunction->addLines("self = [self init];");
-  initWithByteBufferFunction->addLines("if (self) {");
-  objectiveData->addFunction(initWithByteBufferFunction);
+  initDataFunction->addLines("self = [self init];");
+  initDataFunction->addLines("if (self) {");
+  objectiveData->addFunction(initDataFunction);
   
   string fullPath = basePath + fileName;
   vector<string> propertyList;
   vector<string> propertyTypeList;
-  ifstream indata;
-  indata.open(fullPath);
+  vector<ObjectiveType *> columnTypes;
+  vector<ObjectiveProperty *> properties;
+  vector<string> propertyElementTypes;
+  vector<bool> propertyPacked;
+  unique_ptr<ColumnarTableWriter> columnar;
+  string content;
+  readFileContent(fullPath, content);
+  stripByteOrderMark(content);
+  TextScan textScan = scanText(content.data(), content.size());
+  if (textScan.invalidOffset != string::npos) {
+    validator.error(lineOfOffset(content, textScan.invalidOffset), 0, "invalid UTF-8");
+  }
+  size_t linePosition = 0;
   string cell;
   
   int lineNumber = -2;
   int idIndex = -1;
   string key;
-  unordered_set<string> stringIdSet;
+  StringRefSet stringIdSet;
   // put temporary 0 for replacement in the future
   uint32_t pos = buffer->size();
   buffer->putInt(0);
   bool isGroup = false;
   const static string namePrefix = "name";
   string idIvar;
-  while (getline(indata , cell, '\r')) {
+  // name_ columns written into game.dat when strings are embedded
+  vector<int> embeddedColumns;
+  vector<string> embeddedStrings;
+  vector<vector<string>> embeddedValues;
+  vector<string> columnElementTypes;
+  vector<string> columnReferences;
+  vector<bool> columnPacked;
+  // rows of the column table when DataDecoder reads the row
+  vector<string> columnDescriptors;
+  bool usesDescriptors = options.columnDescriptors && !options.columnar;
+  bool isReferenced = options.referencedTables.count(name) > 0;
+  TableLinks tableLinks;
+  vector<string> tokens;
+  ProfileScope parseScope(PhaseEncode, "parse");
+  while (nextLine(content, linePosition, cell, '\r')) {
     cell.erase(std::remove(cell.begin(), cell.end(), '\n'), cell.end());
-    istringstream ss(cell);
-    regex e("[\t,]");
-    sregex_token_iterator iter(cell.begin(),
-                               cell.end(),
-                               e,
-                               -1);
+    {
+      ProfileScope tokenizeScope(PhaseTokenize);
+      splitCells(cell, CSV_SEPARATOR_CHARS, tokens);
+    }
+    ProfileScope encodeScope(PhaseEncode);
+    int row = lineNumber + 3;
     int colNum = 0;
     string id_string;
-    for ( ; iter != sregex_token_iterator(); ++iter) {
-      string token = *iter;
+    for (string &token : tokens) {
+      sanitizeCell(token, lineNumber < 0 ? HeaderText : DataText, textScan.needsCleaning);
       if (lineNumber == -2) {
-        token = _stripToken(token);
         propertyList.push_back(token);
       } else if (lineNumber == -1) {
-        token = _stripToken(token);
         propertyTypeList.push_back(token);
+        if (propertyTypeList.size() > propertyList.size()) {
+          continue;
+        }
         if (!token.compare(0, namePrefix.size(), namePrefix) && token.size() > namePrefix.size() + 1) {
           string stringFuncName = token.substr(namePrefix.size() + 1);
           string prefixString = propertyList[propertyTypeList.size() - 1];
-          assert(idIvar.size() > 0);
-          string getStringFuncName = nameChange(stringFuncName, GetOriginFunc);
-          StaticCPPFunction *staticCppFunction = new StaticCPPFunction("static NSString * " + getStringFuncName + "(NSString *" + idIvar +")");
-          staticCppFunction->addLines("NSString *string = [NSString stringWithFormat:@\"" + prefixString + "_%@\", " + idIvar + "];");
-          staticCppFunction->addLines("return NSLocalizedString(string, nil);");
-          objectiveFile->addStaticCPPFunction(staticCppFunction);
-          ObjectiveFunction *getStringFunction = new ObjectiveFunction("-(NSString *)" + stringFuncName);
-          getStringFunction->addLines("return " + getStringFuncName + "(_" + idIvar + ");" );
+          if (idIvar.size() == 0) {
+            validator.error(row, (int)propertyTypeList.size(), "localized column '" + prefixString + "' must come after the id column");
+          }
+          ObjectiveFunction *getStringFunction = arena.make<ObjectiveFunction>("-(NSString *)" + stringFuncName);
+          if (options.embedStrings) {
+            string stringsIvar = "_" + stringFuncName + "Strings";
+            objectiveFile->addStaticProperty(arena.make<ObjectiveProperty>(stringsIvar, arena.type("NSArray", true)));
+            getStringFunction->addLines("return " + stringsIvar + "[_rowIndex];");
+            embeddedColumns.push_back((int)propertyTypeList.size() - 1);
+            embeddedStrings.push_back(stringFuncName);
+            embeddedValues.push_back(vector<string>());
+          } else {
+            string getStringFuncName = nameChange(stringFuncName, GetOriginFunc);
+            StaticCPPFunction *staticCppFunction = arena.make<StaticCPPFunction>("static NSString * " + getStringFuncName + "(NSString *" + idIvar +")");
+            staticCppFunction->addLines("NSString *string = [NSString stringWithFormat:@\"" + prefixString + "_%@\", " + idIvar + "];");
+            staticCppFunction->addLines("return NSLocalizedString(string, nil);");
+            objectiveFile->addStaticCPPFunction(staticCppFunction);
+            getStringFunction->addLines("return " + getStringFuncName + "(_" + idIvar + ");" );
+          }
           objectiveData->addFunction(getStringFunction);
         } else if (token == "id" || token == "stringId") {
           idIndex = (int)propertyTypeList.size() - 1;
@@ -277,84 +929,244 @@ ObjectiveFile* convertCSVToObjectiveClass(const string &basePath,
         if (colNum == idIndex) {
           id_string = token;
           if (!isGroup) {
-            assert(!stringIdSet.count(token));
-            stringIdSet.insert(token);
+            validator.insertUnique(stringIdSet, token, row, colNum + 1, "id");
           }
         } else {
           string propertyType = propertyTypeList[colNum];
           if (!propertyType.compare(0, namePrefix.size(), namePrefix)) {
-            assert(id_string.size() > 0);
+            if (id_string.size() == 0) {
+              validator.error(row, colNum + 1, "localized value without an id");
+            }
             string propertyName = id_string;
             if (propertyList[colNum] != ";") {
               propertyName = propertyList[colNum] + "_" + id_string;
             }
-            localizedMap[propertyName] = token;
+            ProfileScope localizeScope(PhaseLocalize);
+            localizedMap.set(propertyName, token);
+            for (int i = 0; i < embeddedColumns.size(); ++i) {
+              if (embeddedColumns[i] == colNum) {
+                embeddedValues[i].push_back(token);
+              }
+            }
           }
         }
-        string propertyType = propertyTypeList[colNum];
-        ObjectiveType *objectiveType = _getPropertyType(propertyType);
+        ObjectiveType *objectiveType = colNum < columnTypes.size() ? columnTypes[colNum] : nullptr;
         if (objectiveType != nullptr) {
-          _saveBuffer(buffer, objectiveType, token);
+          const string &elementType = columnElementTypes[colNum];
+          auto saveCell = [&](const string &value) {
+            if (columnar != nullptr) {
+              columnar->addCell(colNum, value);
+            } else if (!elementType.empty()) {
+              _saveTypedCollection(buffer, elementType, value);
+            } else {
+              _saveBuffer(buffer, objectiveType, value);
+            }
+          };
+          try {
+            if (columnReferences[colNum].empty()) {
+              saveCell(token);
+            } else {
+              // the row indices are only known once every table is converted, -1 until then
+              vector<string> ids(1, token);
+              if (!elementType.empty()) {
+                splitCells(token, ";", ids);
+                if (ids.size() == 1 && ids[0].empty()) {
+                  ids.clear();
+                }
+              }
+              size_t first = columnar != nullptr ? columnar->valueCount(colNum) : buffer->size() + (elementType.empty() ? 0 : 8);
+              string placeholder;
+              for (size_t i = 0; i < ids.size(); ++i) {
+                placeholder += i > 0 ? ";-1" : "-1";
+                if (!ids[i].empty() || !elementType.empty()) {
+                  tableLinks.references.push_back({columnReferences[colNum], ids[i], (uint32_t)(columnar != nullptr ? first + i : first + 4 * i), row, colNum + 1});
+                }
+              }
+              saveCell(placeholder);
+            }
+          } catch (const logic_error &) {
+            validator.error(row, colNum + 1, "'" + token + "' is not a valid " + propertyTypeList[colNum]);
+            saveCell(elementType.empty() ? "0" : "");
+          }
         }
         colNum++;
-        if (colNum > propertyList.size()) {
+        if (colNum >= propertyList.size()) {
           break;
         }
       }
     }
-    if (lineNumber >= 0) {
-      assert(colNum == propertyList.size());
+    if (lineNumber >= 0 && tokens.size() != propertyList.size()) {
+      validator.error(row, 0, "expected " + to_string(propertyList.size()) + " columns, found " + to_string(tokens.size()));
+    }
+    if (lineNumber >= 0 && links != nullptr && !isGroup) {
+      tableLinks.keys.push_back(id_string);
     }
     
     if (++lineNumber == 0) {
       bool containIDorGroupId = false;
-      assert(propertyList.size() == propertyTypeList.size());
+      if (propertyList.size() != propertyTypeList.size()) {
+        validator.error(2, 0, to_string(propertyList.size()) + " column names but " + to_string(propertyTypeList.size()) + " column types");
+        propertyTypeList.resize(propertyList.size());
+      }
       for (int i = 0; i < propertyList.size(); ++i) {
         string propertyName = propertyList[i];
         string propertyType = propertyTypeList[i];
-        ObjectiveType *objectiveType = _getPropertyType(propertyType);
+        ObjectiveType *objectiveType = _getPropertyType(arena, propertyType);
+        string elementType = _getElementType(propertyType);
+        string referenceTable = _getReferenceTable(propertyType);
+        columnTypes.push_back(objectiveType);
+        columnElementTypes.push_back(elementType);
+        columnReferences.push_back(objectiveType != nullptr ? referenceTable : "");
+        columnPacked.push_back(options.columnar && options.packNumbers && objectiveType != nullptr && isPackedNumberType(propertyType));
+        if (objectiveType == nullptr && propertyType.find('<') != string::npos) {
+          validator.error(2, i + 1, "unknown collection type '" + propertyType + "'");
+        }
+        if (!referenceTable.empty() && !all_of(referenceTable.begin(), referenceTable.end(), [](char c) { return isalnum((unsigned char)c) || c == '_'; })) {
+          validator.error(2, i + 1, "'" + referenceTable + "' in '" + propertyType + "' is not a table name");
+        }
+        // notes may be in any language, only what becomes code has to be ASCII
+        if (!isAsciiText(propertyType)) {
+          validator.error(2, i + 1, "column type '" + propertyType + "' has to be ASCII");
+        } else if (objectiveType != nullptr && !isAsciiText(propertyName)) {
+          validator.error(1, i + 1, "column name '" + propertyName + "' has to be ASCII to become a property");
+        }
         if (objectiveType != nullptr) {
           if (propertyType == "id" || propertyType == "stringId" || propertyType == "groupId") {
+            if (containIDorGroupId) {
+              validator.error(2, i + 1, "more than one id column, '" + key + "' and '" + propertyName + "'");
+            }
             isGroup = (propertyType == "groupId");
             key = propertyName;
-            assert(!containIDorGroupId);
             containIDorGroupId = true;
             idIndex = i;
           }
-          ObjectiveProperty *objectiveProperty = new ObjectiveProperty(propertyName, objectiveType);
+          string ivarName = propertyName;
+          if (!referenceTable.empty()) {
+            ivarName += elementType.empty() ? "Index" : "Indexes";
+          }
+          ObjectiveProperty *objectiveProperty = arena.make<ObjectiveProperty>(ivarName, objectiveType);
           objectiveData->addProperty(objectiveProperty);
-          initWithByteBufferFunction->addLines(_getReadBufferByType(objectiveProperty));
+          if (!referenceTable.empty()) {
+            _addReferenceGetter(arena, objectiveFile, objectiveData, objectiveProperty, propertyName, referenceTable);
+          }
+          properties.push_back(objectiveProperty);
+          propertyElementTypes.push_back(elementType);
+          propertyPacked.push_back(columnPacked.back());
+          if (options.columnar) {
+            initDataFunction->addLines(_getColumnarReadLine(objectiveProperty));
+          } else if (usesDescriptors) {
+            columnDescriptors.push_back("\t\t{\"_" + objectiveProperty->name() + "\", " + _getColumnKind(objectiveProperty, elementType) + "},");
+          } else if (!elementType.empty()) {
+            _addTypedCollectionReadLines(initDataFunction, objectiveProperty, elementType);
+          } else {
+            initDataFunction->addLines(_getReadBufferByType(objectiveProperty));
+          }
         }
       }
-      assert(containIDorGroupId);
+      if (!containIDorGroupId) {
+        validator.error(2, 0, "no id, stringId or groupId column");
+      }
       
-      initWithByteBufferFunction->addLines("}");
-      initWithByteBufferFunction->addLines("return self;");
+      if (options.columnar) {
+        columnar = std::make_unique<ColumnarTableWriter>(columnTypes, columnElementTypes, columnPacked);
+        if (embeddedStrings.size() > 0) {
+          initDataFunction->addLines("\t_rowIndex = (int)index;");
+        }
+      }
+      if (columnDescriptors.size() > 0) {
+        string count = to_string(columnDescriptors.size());
+        objectiveFile->addImpImportHeaders("\"DataDecoder.h\"");
+        initDataFunction->addLines("\tstatic DataColumn columns[] = {");
+        for (const string &descriptor : columnDescriptors) {
+          initDataFunction->addLines(descriptor);
+        }
+        initDataFunction->addLines("\t};");
+        initDataFunction->addLines("\tstatic dispatch_once_t resolved;");
+        initDataFunction->addLines("\tdispatch_once(&resolved, ^{");
+        initDataFunction->addLines("\t\t[DataDecoder resolveColumns:columns count:" + count + " ofClass:[" + nameChange(name, DataDeclare) + " class]];");
+        initDataFunction->addLines("\t});");
+        initDataFunction->addLines("\t[DataDecoder decodeRow:self buffer:buffer columns:columns count:" + count + "];");
+      }
+      initDataFunction->addLines("}");
+      initDataFunction->addLines("return self;");
+      if (embeddedStrings.size() > 0) {
+        objectiveData->addImpProperty(arena.make<ObjectiveProperty>("_rowIndex", arena.type("int")));
+      }
+      if (embeddedStrings.size() > 0 && !options.columnar) {
+        ObjectiveFunction *initWithRowIndex = arena.make<ObjectiveFunction>("-(instancetype)initWithByteBuffer:(ByteBuffer *)buffer rowIndex:(int)rowIndex");
+        initWithRowIndex->addLines("self = [self initWithByteBuffer:buffer];");
+        initWithRowIndex->addLines("if (self) {");
+        initWithRowIndex->addLines("\t_rowIndex = rowIndex;");
+        initWithRowIndex->addLines("}");
+        initWithRowIndex->addLines("return self;");
+        objectiveData->addFunction(initWithRowIndex);
+      }
     }
   }
-  ObjectiveClass *objectiveDic = _prepareDicClass(name, key, isGroup);
+  if (lineNumber < 0) {
+    // an empty file or one without data rows has no types to build the class from
+    validator.error(lineNumber + 3, 0, "missing type row");
+    return objectiveFile;
+  }
+  ObjectiveClass *objectiveDic;
+  if (options.columnar) {
+    objectiveDic = _prepareColumnarDicClass(arena, name, key, isGroup, properties, propertyElementTypes, propertyPacked, embeddedStrings);
+    if (find(propertyPacked.begin(), propertyPacked.end(), true) != propertyPacked.end()) {
+      objectiveFile->addStaticCPPFunction(_makeUnpackFunction(arena, nameChange(name, DataDicDeclare) + "UnpackNumbers"));
+    }
+  } else {
+    objectiveDic = _prepareDicClass(arena, name, key, isGroup, isReferenced, embeddedStrings);
+  }
   objectiveFile->addClass(objectiveDic);
-  objectiveFile->writeToFile(savePath);
   buffer->putInt(lineNumber, pos);
   buffer->setWritePos(buffer->size());
+  if (columnar != nullptr) {
+    columnar->write(*buffer, lineNumber);
+    // columnar references counted values, now the columns have a place in the buffer
+    for (TableReference &reference : tableLinks.references) {
+      reference.position = columnar->valuePosition(reference.column - 1) + 4 * reference.position;
+    }
+  }
+  for (vector<string> &values : embeddedValues) {
+    // short rows are reported by the validator, keep the section aligned anyway
+    values.resize(lineNumber);
+    for (const string &value : values) {
+      buffer->putString(value);
+    }
+  }
+  Profiler::addRows(lineNumber);
+  if (schema != nullptr) {
+    schema->name = name;
+    schema->isMatrix = false;
+    schema->propertyList = propertyList;
+    schema->propertyTypeList = propertyTypeList;
+    schema->key = key;
+    schema->isGroup = isGroup;
+    schema->isReferenced = isReferenced;
+  }
+  if (links != nullptr) {
+    *links = move(tableLinks);
+  }
   return objectiveFile;
 }
 
 
-ObjectiveFile* convertMatriceCSVToObjectiveClass(const string &basePath,
+ObjectiveFile* convertMatriceCSVToObjectiveClass(ObjectiveArena &arena,
+                                                 const string &basePath,
                                                  const string &fileName,
-                                                 const string &savePath,
-                                                 unique_ptr<bb::ByteBuffer> &buffer)
+                                                 unique_ptr<bb::ByteBuffer> &buffer,
+                                                 Validator &validator,
+                                                 TableSchema *schema)
 {
   string name = fileName.substr(0, fileName.length() - CSV_EXTENSION.length());
-  cout << name << endl;
   string fullPath = basePath + fileName;
-  ifstream indata;
-  indata.open(fullPath);
+  ifstream indata(fullPath, ifstream::binary);
   string cell;
   
-  ObjectiveFile *objectiveFile = new ObjectiveFile(nameChange(name, DataDeclare));
+  ObjectiveFile *objectiveFile = arena.make<ObjectiveFile>(nameChange(name, DataDeclare));
   // 第一行，第一列是ID， 第二列是说明，后面是数据
+  // The values are streamed in a second pass once the row keys are known,
+  // so only one line is held in memory at a time.
   int row = 0;
   string functionName;
   string rowName;
@@ -362,59 +1174,53 @@ ObjectiveFile* convertMatriceCSVToObjectiveClass(const string &basePath,
   string valueType;
   vector<string> rowValues;
   vector<string> colValues;
-  unordered_set<string> rowSet;
-  unordered_set<string> colSet;
-  vector<vector<string>> values;
-  while (getline(indata , cell, '\r')) {
-    cell.erase(std::remove(cell.begin(), cell.end(), '\n'), cell.end());
-    istringstream ss(cell);
-    regex e("[\t,]");
-    sregex_token_iterator iter(cell.begin(),
-                               cell.end(),
-                               e,
-                               -1);
-    int col = 0;
-    vector<string> list;
-    for ( ; iter != sregex_token_iterator(); ++iter) {
-      string token = *iter;
+  StringRefSet rowSet;
+  StringRefSet colSet;
+  vector<string> tokens;
+  {
+    ProfileScope parseScope(PhaseTokenize, "parse");
+    while (getline(indata, cell, '\r')) {
+      cell.erase(std::remove(cell.begin(), cell.end(), '\n'), cell.end());
       if (row == 0) {
-        if (col == 0) {
-          functionName = _stripToken(token);
-        } else if (col == 1) {
-          colName = token;
-        } else {
-          assert(!colSet.count(token));
-          colSet.insert(token);
-          colValues.push_back(token);
+        stripByteOrderMark(cell);
+      }
+      TextScan textScan = scanText(cell.data(), cell.size());
+      if (textScan.invalidOffset != string::npos) {
+        validator.error(row + 1, 0, "invalid UTF-8");
+      }
+      splitCells(cell, CSV_SEPARATOR_CHARS, tokens);
+      for (string &token : tokens) {
+        sanitizeCell(token, DataText, textScan.needsCleaning);
+      }
+      if (row == 0) {
+        for (int col = 0; col < tokens.size(); ++col) {
+          if (col == 0) {
+            functionName = tokens[col];
+            sanitizeCell(functionName, HeaderText);
+          } else if (col == 1) {
+            colName = tokens[col];
+          } else {
+            validator.insertUnique(colSet, tokens[col], row + 1, col + 1, colName);
+            colValues.push_back(tokens[col]);
+          }
         }
       } else if (row == 1) {
-        if (col == 0) {
-          rowName = token;
-        } else if (col == 1) {
-          valueType = token;
+        rowName = tokens[0];
+        if (tokens.size() > 1) {
+          valueType = tokens[1];
         }
       } else {
-        if (col == 0) {
-          assert(!rowSet.count(token));
-          rowSet.insert(token);
-          rowValues.push_back(token);
-        } else if (col > 1) {
-          list.push_back(token);
+        validator.insertUnique(rowSet, tokens[0], row + 1, 1, rowName);
+        rowValues.push_back(tokens[0]);
+        size_t valueCount = tokens.size() > 2 ? tokens.size() - 2 : 0;
+        if (valueCount != colValues.size()) {
+          validator.error(row + 1, 0, "expected " + to_string(colValues.size()) + " values, found " + to_string(valueCount));
         }
       }
-      col++;
-    }
-    if (row > 1) {
-      values.push_back(list);
+      row++;
     }
-    row++;
-  }
-  //validate
-  assert(values.size() == rowValues.size());
-  for (int i = 0; i < values.size(); ++i) {
-    vector<string> list = values[i];
-    assert(list.size() == colValues.size());
   }
+  ProfileScope encodeScope(PhaseEncode, "encode");
   buffer->putLong(colValues.size());
   for (int i = 0; i < colValues.size(); ++i) {
     buffer->putString(colValues[i]);
@@ -423,19 +1229,27 @@ ObjectiveFile* convertMatriceCSVToObjectiveClass(const string &basePath,
   for (int i = 0; i < rowValues.size(); ++i) {
     buffer->putString(rowValues[i]);
   }
-  for (int i = 0; i < values.size(); ++i) {
-    vector<string> list = values[i];
-    for (int j = 0; j < list.size(); ++j) {
-      string value = list[j];
-      buffer->putString(value);
+  indata.clear();
+  indata.seekg(0, ios::beg);
+  for (row = 0; getline(indata, cell, '\r'); ++row) {
+    if (row < 2) {
+      continue;
+    }
+    cell.erase(std::remove(cell.begin(), cell.end(), '\n'), cell.end());
+    bool needsCleaning = scanText(cell.data(), cell.size()).needsCleaning;
+    splitCells(cell, CSV_SEPARATOR_CHARS, tokens);
+    for (int col = 2; col < tokens.size(); ++col) {
+      sanitizeCell(tokens[col], DataText, needsCleaning);
+      buffer->putString(tokens[col]);
     }
   }
+  Profiler::addRows(rowValues.size());
   
-  ObjectiveClass *objectiveData = new ObjectiveClass(nameChange(name, DataDeclare));
+  ObjectiveClass *objectiveData = arena.make<ObjectiveClass>(nameChange(name, DataDeclare));
   objectiveFile->addClass(objectiveData);
   objectiveFile->addImportHeaders("\"ByteBuffer.h\"");
-  objectiveData->addImpProperty(new ObjectiveProperty("_dictionary", new ObjectiveType("NSMutableDictionary", true)));
-  ObjectiveFunction *initWithByteBufferFunction = new ObjectiveFunction("-(instancetype )initWithByteBuffer:(ByteBuffer *)buffer");
+  objectiveData->addImpProperty(arena.make<ObjectiveProperty>("_dictionary", arena.type("NSMutableDictionary", true)));
+  ObjectiveFunction *initWithByteBufferFunction = arena.make<ObjectiveFunction>("-(instancetype )initWithByteBuffer:(ByteBuffer *)buffer");
   initWithByteBufferFunction->addLines("self = [self init];");
   initWithByteBufferFunction->addLines("if (self) {");
   initWithByteBufferFunction->addLines("\t_dictionary = [NSMutableDictionary new];");
@@ -460,13 +1274,13 @@ ObjectiveFile* convertMatriceCSVToObjectiveClass(const string &basePath,
   initWithByteBufferFunction->addLines("}");
   initWithByteBufferFunction->addLines("return self;");
   
-  ObjectiveType *returnType = _getPropertyType(valueType);
+  ObjectiveType *returnType = _getPropertyType(arena, valueType);
   if (returnType == nullptr) {
-    returnType = new ObjectiveType("NSString", true);
+    returnType = arena.type("NSString", true);
   }
   ObjectiveType stringType("NSString",true);
   string getFunctionName = functionName + "By" + nameChange(colName, Uppercase);
-  ObjectiveFunction *getDataFunction = new ObjectiveFunction(getFunctionName,
+  ObjectiveFunction *getDataFunction = arena.make<ObjectiveFunction>(getFunctionName,
                                                              *returnType,
                                                              vector<string>{rowName},
                                                              vector<string>{colName,rowName},
@@ -486,8 +1300,13 @@ ObjectiveFile* convertMatriceCSVToObjectiveClass(const string &basePath,
   objectiveData->addFunction(initWithByteBufferFunction);
   objectiveData->addFunction(getDataFunction);
   
-  
-  objectiveFile->writeToFile(savePath);
-  
+  if (schema != nullptr) {
+    schema->name = name;
+    schema->isMatrix = true;
+    schema->functionName = functionName;
+    schema->colName = colName;
+    schema->rowName = rowName;
+    schema->valueType = valueType;
+  }
   return objectiveFile;
 }
@@ -14,28 +14,112 @@
 #include <string>
 #include <map>
 #include "ObjectiveFile.hpp"
+#include "BuildOptions.hpp"
 #include "ByteBuffer.hpp"
+#include "LocalizedStringTable.hpp"
+#include "Validator.hpp"
 
 using namespace std;
 
 const static string CSV_EXTENSION = ".csv";
+const static string CSV_SEPARATOR = "[\t,]";
+const static char CSV_SEPARATOR_CHARS[] = "\t,";
 
 enum NameType { Origin, Uppercase, DataDeclare, DataDicDeclare, DataDicImp, DataImp, GetOriginFunc};
 
+struct TableSchema
+{
+  string name;
+  bool isMatrix = false;
+  // normal table: header row, type row and the id/groupId column
+  vector<string> propertyList;
+  vector<string> propertyTypeList;
+  string key;
+  bool isGroup = false;
+  // a ref<> column of another table points at it, the Dic keeps its rows in file order
+  bool isReferenced = false;
+  // matrix: the header cells that shape the generated getter
+  string functionName;
+  string colName;
+  string rowName;
+  string valueType;
+  
+  bool operator==(const TableSchema &other) const;
+  bool operator!=(const TableSchema &other) const { return !(*this == other); }
+};
+
+// One ref<table> value. The converter writes -1 where the row index goes,
+// the builder fills it in once every table is converted.
+struct TableReference
+{
+  string table;
+  string id;
+  // of the int32 in the table's buffer
+  uint32_t position;
+  int row;
+  int column;
+};
+
+// what a converted table offers to and needs from the other tables
+struct TableLinks
+{
+  // id of every row in order, empty for group tables
+  vector<string> keys;
+  vector<TableReference> references;
+};
+
 string nameChange(string originName,NameType type);
 
+vector<string> splitStr(const string &str, const string &token);
+// the fields splitStr gives for a character class, without building a regex:
+// a trailing empty field is dropped unless it is the only one
+void splitCells(const string &str, const char *separators, vector<string> &cells);
+
+// encodes one cell of the given type, the layout initWithByteBuffer reads back
+void _saveBuffer(unique_ptr<bb::ByteBuffer> &buffer, ObjectiveType *type, const string &token);
+// "set<int>" gives "int", empty for untyped sets/arrays and everything else.
+// References are stored as row indices, "array<ref<item>>" gives "int" too.
+string _getElementType(const string &propertyType);
+// "ref<item>" and "set<ref<item>>" give "item", empty for everything else
+string _getReferenceTable(const string &propertyType);
+// typed set/array cell, the count followed by the packed values
+void _saveTypedCollection(unique_ptr<bb::ByteBuffer> &buffer, const string &elementType, const string &token);
+
+// DataDecoder.h/.m, the shared row decoder of ConvertOptions::columnDescriptors
+ObjectiveFile *generateDataDecoder(ObjectiveArena &arena);
+
+// the schema bytes of the table's index entry, laid out as GameDataReader.hpp describes
+string encodeTableSchema(const TableSchema &schema, const ConvertOptions &options);
+
 vector<string> getCSVFileList(const string &path);
 
-ObjectiveFile* convertCSVToObjectiveClass(const string &basePath,
+// whole file in one read, then walk it the way getline(stream, line, delimiter) would
+bool readFileContent(const string &path, string &content);
+bool nextLine(const string &content, size_t &position, string &line, char delimiter);
+// the second row of a table CSV, read straight from the disk without converting the file
+vector<string> readTypeRow(const string &path);
+
+// The converters append the table to buffer and return the generated file
+// without writing it, the caller decides whether it needs to hit the disk.
+// Every generated node lives in arena and goes away when it is released.
+// Bad data is reported to validator, the output of a table with errors
+// must not be used.
+ObjectiveFile* convertCSVToObjectiveClass(ObjectiveArena &arena,
+                                          const string &basePath,
                                           const string &fileName,
-                                          const string &savePath,
-                                          map<string, string> &localizedMap,
-                                          unique_ptr<bb::ByteBuffer> &buffer);
+                                          LocalizedStringTable &localizedMap,
+                                          unique_ptr<bb::ByteBuffer> &buffer,
+                                          Validator &validator,
+                                          const ConvertOptions &options,
+                                          TableSchema *schema = nullptr,
+                                          TableLinks *links = nullptr);
 
-ObjectiveFile* convertMatriceCSVToObjectiveClass(const string &basePath,
+ObjectiveFile* convertMatriceCSVToObjectiveClass(ObjectiveArena &arena,
+                                                 const string &basePath,
                                                  const string &fileName,
-                                                 const string &savePath,
-                                                 unique_ptr<bb::ByteBuffer> &buffer);
+                                                 unique_ptr<bb::ByteBuffer> &buffer,
+                                                 Validator &validator,
+                                                 TableSchema *schema = nullptr);
 
 
 #endif /* ReadCSVFile_hpp */
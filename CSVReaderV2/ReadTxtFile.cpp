@@ -10,8 +10,11 @@
 #include <iostream>
 #include <fstream>
 #include <dirent.h>
-#include <assert.h>
 #include <regex>
+#include <string.h>
+#include "Profiler.hpp"
+#include "ReadCSVFile.hpp"
+#include "TextHygiene.hpp"
 
 vector<string> getTXTFileList(const string &path) {
   vector<string> result;
@@ -39,32 +42,39 @@ vector<string> getTXTFileList(const string &path) {
   return result;
 }
 
-void readFile(string basePath, string fileName, map<string, string> &localizedMap)
+void readFile(string basePath, string fileName, LocalizedStringTable &localizedMap, Validator &validator)
 {
   string txtEXT = ".txt";
   string name = fileName.substr(0, fileName.length() - txtEXT.length());
-  cout << name << endl;
   string fullPath = basePath + fileName;
-  vector<string> propertyList;
-  vector<string> propertyTypeList;
-  ifstream indata;
-  indata.open(fullPath);
-  string cell;
   int lineNumber = 1;
   string prefix = name + "_";
   smatch match;
   regex e("\"([^\"]+)\"[ ]*=[ ]*\"([^\"]+)\";");
   bool typeSame = false;
   string textString;
-  while (getline(indata , cell, '\r')) {
-    textString += cell + '\r';
+  readFileContent(fullPath, textString);
+  stripByteOrderMark(textString);
+  TextScan textScan = scanText(textString.data(), textString.size());
+  if (textScan.invalidOffset != string::npos) {
+    validator.error(lineOfOffset(textString, textScan.invalidOffset), 0, "invalid UTF-8");
   }
+  ProfileScope parseScope(PhaseTokenize, "parse");
   regex e1("[\n\r]");
   sregex_token_iterator iter(textString.begin(),
                              textString.end(),
                              e1,
                              -1);
+  int fileLine = 1;
+  size_t counted = 0;
   for ( ; iter != sregex_token_iterator(); ++iter) {
+    // only needed for error messages, "\r\n" counts as one line break
+    for (size_t offset = iter->first - textString.cbegin(); counted < offset; ++counted) {
+      char c = textString[counted];
+      if (c == '\n' || (c == '\r' && (counted + 1 == textString.size() || textString[counted + 1] != '\n'))) {
+        fileLine++;
+      }
+    }
     string cell = *iter;
     string key;
     string value;
@@ -75,14 +85,20 @@ void readFile(string basePath, string fileName, map<string, string> &localizedMa
         value = match[2];
       }
     } else if (cell.size() > 0){
-      assert(!typeSame);
+      if (typeSame) {
+        validator.error(fileLine, 0, "plain line mixed with \"key\" = \"value\"; lines");
+      }
       key = prefix + to_string(lineNumber);
       value = cell;
     } else {
       continue;
     }
-    assert(!localizedMap.count(key));
-    localizedMap[key] = value;
+    sanitizeCell(value, DataText, textScan.needsCleaning);
+    ProfileScope localizeScope(PhaseLocalize);
+    if (!localizedMap.set(key, value)) {
+      validator.error(fileLine, 0, "duplicate key '" + key + "'");
+    }
     lineNumber++;
   }
+  Profiler::addRows(lineNumber - 1);
 }
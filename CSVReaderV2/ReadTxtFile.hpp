@@ -13,10 +13,12 @@
 #include <map>
 #include <string>
 #include <vector>
+#include "LocalizedStringTable.hpp"
+#include "Validator.hpp"
 
 using namespace std;
 vector<string> getTXTFileList(const string &path);
 
-void readFile(string basePath, string fileName, map<string, string> &localizedMap);
+void readFile(string basePath, string fileName, LocalizedStringTable &localizedMap, Validator &validator);
 
 #endif /* ReadTxtFile_hpp */
@@ -0,0 +1,110 @@
+//
+//  ShardPlan.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "ShardPlan.hpp"
+#include <sstream>
+#include <unordered_set>
+#include "ReadCSVFile.hpp"
+
+static bool _isIdentifier(const string &name)
+{
+  if (name.empty() || isdigit((unsigned char)name[0])) {
+    return false;
+  }
+  for (char c : name) {
+    if (!isalnum((unsigned char)c) && c != '_') {
+      return false;
+    }
+  }
+  return true;
+}
+
+void readShardMap(const string &path, map<string, string> &tableShards, Validator &validator)
+{
+  tableShards.clear();
+  string content;
+  if (!readFileContent(path, content)) {
+    validator.error(0, 0, "can't read the shard map");
+    return;
+  }
+  istringstream lines(content);
+  string line;
+  for (int row = 1; getline(lines, line); ++row) {
+    line = line.substr(0, line.find('#'));
+    size_t colon = line.find(':');
+    istringstream words(line.substr(colon == string::npos ? 0 : colon + 1));
+    string shard;
+    istringstream(line.substr(0, colon)) >> shard;
+    if (colon == string::npos) {
+      if (shard.size() > 0) {
+        validator.error(row, 0, "expected 'shard: table table ...'");
+      }
+      continue;
+    }
+    if (!_isIdentifier(shard)) {
+      validator.error(row, 1, "shard name '" + shard + "' may only contain letters, digits and _");
+      continue;
+    }
+    string table;
+    while (words >> table) {
+      auto inserted = tableShards.insert(make_pair(table, shard));
+      if (!inserted.second && inserted.first->second != shard) {
+        validator.error(row, 0, "table '" + table + "' is already in shard '" + inserted.first->second + "'");
+      }
+    }
+  }
+}
+
+vector<GameDataShard> planShards(const vector<pair<string, uint32_t>> &tables,
+                                 const map<string, string> &tableShards,
+                                 size_t budget,
+                                 Validator &validator)
+{
+  vector<GameDataShard> shards;
+  map<string, size_t> shardIndex;
+  unordered_set<string> tableNames;
+  int packedShard = -1;
+  for (size_t i = 0; i < tables.size(); ++i) {
+    const string &table = tables[i].first;
+    uint32_t size = tables[i].second;
+    tableNames.insert(table);
+    auto mapped = tableShards.find(table);
+    string name;
+    if (mapped != tableShards.end()) {
+      name = mapped->second;
+    } else if (budget == 0) {
+      name = "game";
+    } else {
+      if (packedShard < 0 || (shards[packedShard].size > 0 && shards[packedShard].size + size > budget)) {
+        int number = 0;
+        while (shardIndex.count("game" + to_string(number)) > 0) {
+          number++;
+        }
+        shardIndex["game" + to_string(number)] = shards.size();
+        packedShard = (int)shards.size();
+        shards.push_back(GameDataShard());
+        shards.back().name = "game" + to_string(number);
+      }
+      name = shards[packedShard].name;
+    }
+    auto found = shardIndex.find(name);
+    if (found == shardIndex.end()) {
+      found = shardIndex.insert(make_pair(name, shards.size())).first;
+      shards.push_back(GameDataShard());
+      shards.back().name = name;
+    }
+    shards[found->second].tables.push_back(i);
+    shards[found->second].size += size;
+  }
+  for (auto &mapped : tableShards) {
+    if (tableNames.count(mapped.first) == 0) {
+      validator.error(0, 0, "shard '" + mapped.second + "' lists unknown table '" + mapped.first + "'");
+    }
+  }
+  return shards;
+}
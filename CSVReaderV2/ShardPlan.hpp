@@ -0,0 +1,43 @@
+//
+//  ShardPlan.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef ShardPlan_hpp
+#define ShardPlan_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "Validator.hpp"
+
+using namespace std;
+
+// One data file of a sharded build, written to Resources/<name>.dat
+struct GameDataShard
+{
+  string name;
+  // positions in the table list, in game.dat order
+  vector<size_t> tables;
+  uint32_t size = 0;
+};
+
+// Reads the grouping file of --shards, one "shard: table table ..." per line,
+// # starts a comment. Names must be usable in a selector.
+void readShardMap(const string &path, map<string, string> &tableShards, Validator &validator);
+
+// Tables listed in tableShards go to their shard. The others are packed in
+// order into game0, game1... of at most budget bytes, or all into one shard
+// named game when there is no budget. A table larger than the budget gets a
+// shard of its own.
+vector<GameDataShard> planShards(const vector<pair<string, uint32_t>> &tables,
+                                 const map<string, string> &tableShards,
+                                 size_t budget,
+                                 Validator &validator);
+
+#endif /* ShardPlan_hpp */
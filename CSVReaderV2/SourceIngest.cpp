@@ -0,0 +1,450 @@
+//
+//  SourceIngest.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "SourceIngest.hpp"
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+// openat, statx and read on a ring came with Linux 5.6, as did this flag
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define SOURCE_INGEST_RING 1
+#endif
+#endif
+#endif
+
+static const unsigned kReadThreads = 4;
+
+static SourceIngest *_activeIngest = nullptr;
+
+static bool _readWholeFile(const string &path, string &content)
+{
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+  content.resize((size_t)st.st_size);
+  size_t length = 0;
+  while (length < content.size()) {
+    ssize_t count = read(fd, &content[length], content.size() - length);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    length += count;
+  }
+  content.resize(length);
+  close(fd);
+  return true;
+}
+
+#ifdef SOURCE_INGEST_RING
+
+struct SourceIngest::Ring
+{
+  int fd = -1;
+  unsigned entries = 0;
+  unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+  unsigned *cqHead, *cqTail, *cqMask;
+  io_uring_sqe *sqes;
+  io_uring_cqe *cqes;
+  void *sqMap = MAP_FAILED;
+  void *cqMap = MAP_FAILED;
+  size_t sqMapSize = 0;
+  size_t cqMapSize = 0;
+  size_t sqeMapSize = 0;
+  // queued since the last io_uring_enter
+  unsigned queued = 0;
+
+  bool setup(unsigned size);
+  ~Ring();
+  io_uring_sqe *next();
+  int enter(unsigned waitFor);
+};
+
+bool SourceIngest::Ring::setup(unsigned size)
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  fd = (int)syscall(__NR_io_uring_setup, size, &params);
+  if (fd < 0) {
+    return false;
+  }
+  entries = params.sq_entries;
+  sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (singleMap) {
+    sqMapSize = cqMapSize = max(sqMapSize, cqMapSize);
+  }
+  sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (sqMap == MAP_FAILED) {
+    return false;
+  }
+  cqMap = singleMap ? sqMap : mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  if (cqMap == MAP_FAILED) {
+    return false;
+  }
+  sqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+  sqes = (io_uring_sqe *)mmap(nullptr, sqeMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    sqes = nullptr;
+    return false;
+  }
+  char *sq = (char *)sqMap;
+  sqHead = (unsigned *)(sq + params.sq_off.head);
+  sqTail = (unsigned *)(sq + params.sq_off.tail);
+  sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+  sqArray = (unsigned *)(sq + params.sq_off.array);
+  char *cq = (char *)cqMap;
+  cqHead = (unsigned *)(cq + params.cq_off.head);
+  cqTail = (unsigned *)(cq + params.cq_off.tail);
+  cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+  cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+  return true;
+}
+
+SourceIngest::Ring::~Ring()
+{
+  if (sqes != nullptr) {
+    munmap(sqes, sqeMapSize);
+  }
+  if (cqMap != MAP_FAILED && cqMap != sqMap) {
+    munmap(cqMap, cqMapSize);
+  }
+  if (sqMap != MAP_FAILED) {
+    munmap(sqMap, sqMapSize);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+io_uring_sqe *SourceIngest::Ring::next()
+{
+  unsigned tail = *sqTail;
+  unsigned index = tail & *sqMask;
+  io_uring_sqe *sqe = &sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqArray[index] = index;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+  queued++;
+  return sqe;
+}
+
+int SourceIngest::Ring::enter(unsigned waitFor)
+{
+  int result = (int)syscall(__NR_io_uring_enter, fd, queued, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+  if (result >= 0) {
+    queued -= min((unsigned)result, queued);
+  }
+  return result;
+}
+
+void SourceIngest::_readWithRing()
+{
+  enum Operation { OpenOperation, StatxOperation, ReadOperation, CloseOperation };
+  struct FileState
+  {
+    int fd = -1;
+    int64_t size = -1;
+    size_t offset = 0;
+    int pending = 0;
+    bool failed = false;
+    // the kernel doesn't know one of the operations, read the file the old way
+    bool fallback = false;
+    // what the kernel writes into, on the heap so it can be left behind if the ring breaks mid-flight
+    struct Transfer
+    {
+      struct statx stat;
+      string content;
+    };
+    unique_ptr<Transfer> transfer = std::make_unique<Transfer>();
+  };
+  Ring &ring = *_ring;
+  vector<FileState> files(_sources.size());
+  unsigned inFlight = 0;
+  size_t next = 0;
+  auto userData = [](size_t index, Operation operation) { return (uint64_t)index << 2 | operation; };
+  auto submitRead = [&](size_t index) {
+    FileState &file = files[index];
+    io_uring_sqe *sqe = ring.next();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = file.fd;
+    sqe->addr = (uint64_t)(uintptr_t)&file.transfer->content[file.offset];
+    sqe->len = (unsigned)min<size_t>(file.size - file.offset, 1u << 30);
+    sqe->off = file.offset;
+    sqe->user_data = userData(index, ReadOperation);
+    file.pending++;
+    inFlight++;
+  };
+  auto complete = [&](size_t index) {
+    FileState &file = files[index];
+    if (file.fd >= 0) {
+      // nobody waits for the close
+      io_uring_sqe *sqe = ring.next();
+      sqe->opcode = IORING_OP_CLOSE;
+      sqe->fd = file.fd;
+      sqe->user_data = userData(index, CloseOperation);
+      file.fd = -1;
+      inFlight++;
+    }
+    if (file.fallback && !file.failed) {
+      _finish(index, _readWholeFile(_sources[index].path, _sources[index].content));
+      return;
+    }
+    if (!file.failed) {
+      file.transfer->content.resize(file.offset);
+      _sources[index].content.swap(file.transfer->content);
+    }
+    file.transfer.reset();
+    _finish(index, !file.failed);
+  };
+  while (true) {
+    size_t limit;
+    {
+      unique_lock<mutex> lock(_mutex);
+      if (inFlight == 0) {
+        _advance.wait(lock, [&] { return _stopping || _mayStart(next); });
+      }
+      if (_stopping && inFlight == 0) {
+        break;
+      }
+      limit = _stopping ? next : _windowEnd();
+    }
+    // every file has at most two operations in flight, a close included
+    for (; next < limit && inFlight + 2 <= ring.entries; ++next) {
+      const char *path = _sources[next].path.c_str();
+      io_uring_sqe *openEntry = ring.next();
+      openEntry->opcode = IORING_OP_OPENAT;
+      openEntry->fd = AT_FDCWD;
+      openEntry->addr = (uint64_t)(uintptr_t)path;
+      openEntry->open_flags = O_RDONLY | O_CLOEXEC;
+      openEntry->user_data = userData(next, OpenOperation);
+      io_uring_sqe *statxEntry = ring.next();
+      statxEntry->opcode = IORING_OP_STATX;
+      statxEntry->fd = AT_FDCWD;
+      statxEntry->addr = (uint64_t)(uintptr_t)path;
+      statxEntry->len = STATX_SIZE;
+      statxEntry->off = (uint64_t)(uintptr_t)&files[next].transfer->stat;
+      statxEntry->user_data = userData(next, StatxOperation);
+      files[next].pending = 2;
+      inFlight += 2;
+    }
+    if (ring.enter(inFlight > 0 ? 1 : 0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      // the ring broke, whatever is left is read synchronously
+      break;
+    }
+    unsigned head = *ring.cqHead;
+    unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      io_uring_cqe *cqe = &ring.cqes[head & *ring.cqMask];
+      size_t index = (size_t)(cqe->user_data >> 2);
+      Operation operation = (Operation)(cqe->user_data & 3);
+      int result = cqe->res;
+      inFlight--;
+      if (operation == CloseOperation) {
+        continue;
+      }
+      FileState &file = files[index];
+      file.pending--;
+      if (result == -EINVAL || result == -EOPNOTSUPP) {
+        file.fallback = true;
+      } else if (result < 0) {
+        file.failed = true;
+      } else if (operation == OpenOperation) {
+        file.fd = result;
+      } else if (operation == StatxOperation) {
+        file.size = (int64_t)file.transfer->stat.stx_size;
+        file.transfer->content.resize((size_t)file.size);
+      } else if (result == 0) {
+        // the file got shorter since statx
+        file.size = file.offset;
+      } else {
+        file.offset += result;
+      }
+      if (file.pending > 0) {
+        continue;
+      }
+      if (!file.failed && !file.fallback && file.size > (int64_t)file.offset) {
+        submitRead(index);
+      } else {
+        complete(index);
+      }
+    }
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+  }
+  for (FileState &file : files) {
+    if (file.pending > 0) {
+      // the ring broke with a statx or read still queued, the kernel may write into
+      // the transfer at any time, so it is never freed and the file is read again elsewhere
+      file.transfer.release();
+    }
+    if (file.fd >= 0) {
+      close(file.fd);
+    }
+  }
+  // the ring is gone or was never needed again, finish the rest by hand
+  for (size_t i = 0; i < _sources.size(); ++i) {
+    unique_lock<mutex> lock(_mutex);
+    if (_sources[i].done || _stopping) {
+      continue;
+    }
+    lock.unlock();
+    _finish(i, _readWholeFile(_sources[i].path, _sources[i].content));
+  }
+}
+
+#else
+
+struct SourceIngest::Ring
+{
+};
+
+void SourceIngest::_readWithRing()
+{
+}
+
+#endif
+
+SourceIngest::SourceIngest(const vector<string> &paths, const vector<int64_t> &sizes, size_t readAhead)
+{
+  _sources.resize(paths.size());
+  _ends.resize(paths.size());
+  size_t end = 0;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    _sources[i].path = paths[i];
+    _indexes[paths[i]] = i;
+    end += i < sizes.size() && sizes[i] > 0 ? (size_t)sizes[i] : 0;
+    _ends[i] = end;
+  }
+  _readAhead = readAhead;
+  if (_activeIngest == nullptr) {
+    _activeIngest = this;
+  }
+  if (paths.empty()) {
+    return;
+  }
+#ifdef SOURCE_INGEST_RING
+  _ring = std::make_unique<Ring>();
+  if (_ring->setup(64)) {
+    _threads.emplace_back(&SourceIngest::_readWithRing, this);
+    return;
+  }
+  // seccomp, old kernels and io_uring_disabled all end up here
+  _ring.reset();
+#endif
+  unsigned threadCount = (unsigned)min<size_t>(kReadThreads, paths.size());
+  for (unsigned i = 0; i < threadCount; ++i) {
+    _threads.emplace_back(&SourceIngest::_readWithThreads, this);
+  }
+}
+
+SourceIngest::~SourceIngest()
+{
+  {
+    lock_guard<mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _advance.notify_all();
+  for (thread &reader : _threads) {
+    reader.join();
+  }
+  if (_activeIngest == this) {
+    _activeIngest = nullptr;
+  }
+}
+
+size_t SourceIngest::_windowEnd() const
+{
+  if (_sources.empty()) {
+    return 0;
+  }
+  size_t limit = _ends[_current] + min(_readAhead, SIZE_MAX - _ends[_current]);
+  size_t end = upper_bound(_ends.begin() + _current, _ends.end(), limit) - _ends.begin();
+  return max(end, _current + 1);
+}
+
+void SourceIngest::setReadAhead(size_t bytes)
+{
+  {
+    lock_guard<mutex> lock(_mutex);
+    _readAhead = bytes;
+  }
+  _advance.notify_all();
+}
+
+void SourceIngest::_finish(size_t index, bool ok)
+{
+  {
+    lock_guard<mutex> lock(_mutex);
+    _sources[index].ok = ok;
+    _sources[index].done = true;
+  }
+  _ready.notify_all();
+}
+
+void SourceIngest::_readWithThreads()
+{
+  while (true) {
+    size_t index;
+    {
+      unique_lock<mutex> lock(_mutex);
+      _advance.wait(lock, [&] { return _stopping || _mayStart(_next); });
+      if (_stopping) {
+        return;
+      }
+      index = _next++;
+    }
+    Source &source = _sources[index];
+    _finish(index, _readWholeFile(source.path, source.content));
+  }
+}
+
+bool SourceIngest::take(const string &path, string &content)
+{
+  auto found = _indexes.find(path);
+  if (found == _indexes.end()) {
+    return false;
+  }
+  size_t index = found->second;
+  Source &source = _sources[index];
+  unique_lock<mutex> lock(_mutex);
+  if (index > _current) {
+    _current = index;
+    _advance.notify_all();
+  }
+  _ready.wait(lock, [&] { return source.done; });
+  if (!source.ok) {
+    return false;
+  }
+  content.swap(source.content);
+  string().swap(source.content);
+  // taking a file only matters once, a second read goes to the disk
+  source.ok = false;
+  return true;
+}
+
+bool SourceIngest::takeActive(const string &path, string &content)
+{
+  return _activeIngest != nullptr && _activeIngest->take(path, content);
+}
@@ -0,0 +1,75 @@
+//
+//  SourceIngest.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef SourceIngest_hpp
+#define SourceIngest_hpp
+
+#include <stdio.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Reads the source files of a build ahead of the converter, so the I/O of
+// the next files overlaps parsing the current one. On Linux the open, statx
+// and read of every file go through one io_uring and are all in flight at
+// once, elsewhere (or when the kernel refuses the ring) a few threads read
+// them. The files past the last one taken are read as long as they fit into
+// the read-ahead, in bytes, the one taken next is always read.
+class SourceIngest
+{
+private:
+  struct Source
+  {
+    string path;
+    string content;
+    bool done = false;
+    bool ok = false;
+  };
+  struct Ring;
+
+  vector<Source> _sources;
+  // sizes of the files up to and including each one
+  vector<size_t> _ends;
+  unordered_map<string, size_t> _indexes;
+  mutex _mutex;
+  // the converter waits on _ready, the readers on _advance
+  condition_variable _ready;
+  condition_variable _advance;
+  // the last file taken and how many bytes past it may be read
+  size_t _current = 0;
+  size_t _readAhead = 0;
+  size_t _next = 0;
+  bool _stopping = false;
+  unique_ptr<Ring> _ring;
+  vector<thread> _threads;
+
+  size_t _windowEnd() const;
+  bool _mayStart(size_t index) const { return index < _windowEnd(); }
+  void _finish(size_t index, bool ok);
+  void _readWithThreads();
+  void _readWithRing();
+public:
+  // sizes are what the files took when they were stat'ed, -1 when unknown
+  SourceIngest(const vector<string> &paths, const vector<int64_t> &sizes, size_t readAhead);
+  ~SourceIngest();
+  bool usesRing() const { return _ring != nullptr; }
+  void setReadAhead(size_t bytes);
+  // waits for the file, false when it isn't part of the batch or couldn't be read
+  bool take(const string &path, string &content);
+
+  // readFileContent asks the ingest of the running build first
+  static bool takeActive(const string &path, string &content);
+};
+
+#endif /* SourceIngest_hpp */
@@ -0,0 +1,105 @@
+//
+//  SpillStore.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "SpillStore.hpp"
+#include <dirent.h>
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const size_t kCopyChunk = 1 << 20;
+
+SpillStore::SpillStore(const string &basePath)
+{
+  _basePath = basePath;
+  if (_basePath.empty()) {
+    const char *temporary = getenv("TMPDIR");
+    _basePath = temporary != nullptr && temporary[0] != '\0' ? temporary : "/tmp";
+  }
+  if (_basePath.back() != '/') {
+    _basePath += "/";
+  }
+}
+
+SpillStore::~SpillStore()
+{
+  if (_directory.empty()) {
+    return;
+  }
+  DIR *dir = opendir(_directory.c_str());
+  if (dir != NULL) {
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+      if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+        unlink((_directory + ent->d_name).c_str());
+      }
+    }
+    closedir(dir);
+  }
+  rmdir(_directory.c_str());
+}
+
+string SpillStore::path(const string &name)
+{
+  if (_directory.empty()) {
+    string pattern = _basePath + "csvreader-spill-XXXXXX";
+    if (mkdtemp(&pattern[0]) == nullptr) {
+      perror(pattern.c_str());
+      return "";
+    }
+    _directory = pattern + "/";
+  }
+  return _directory + name;
+}
+
+bool SpillStore::write(const string &name, const uint8_t *data, size_t length)
+{
+  string filePath = path(name);
+  if (filePath.empty()) {
+    return false;
+  }
+  ofstream outfile(filePath, ofstream::binary | ofstream::trunc);
+  outfile.write((const char *)data, length);
+  return outfile.good();
+}
+
+bool SpillStore::read(const string &name, bb::ByteBuffer &buffer)
+{
+  ifstream indata(path(name), ifstream::binary | ifstream::ate);
+  if (!indata) {
+    return false;
+  }
+  uint32_t length = (uint32_t)indata.tellg();
+  indata.seekg(0, ios::beg);
+  buffer.resize(length);
+  indata.read((char *)buffer.data(), length);
+  buffer.setWritePos(length);
+  return indata.good();
+}
+
+bool SpillStore::copyTo(const string &name, ostream &out)
+{
+  ifstream indata(path(name), ifstream::binary);
+  if (!indata) {
+    return false;
+  }
+  string chunk(kCopyChunk, '\0');
+  while (indata) {
+    indata.read(&chunk[0], chunk.size());
+    out.write(chunk.data(), indata.gcount());
+  }
+  return out.good();
+}
+
+void SpillStore::remove(const string &name)
+{
+  if (!_directory.empty()) {
+    unlink((_directory + name).c_str());
+  }
+}
@@ -0,0 +1,41 @@
+//
+//  SpillStore.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef SpillStore_hpp
+#define SpillStore_hpp
+
+#include <stdio.h>
+#include <ostream>
+#include <string>
+#include "ByteBuffer.hpp"
+
+using namespace std;
+
+// Temporary files for converted data that doesn't fit into --memory-mb.
+// The directory is created under basePath ($TMPDIR or /tmp when empty) on
+// first use and removed with everything in it when the store goes away
+// (a --watch stopped by a signal leaves it behind).
+class SpillStore
+{
+private:
+  string _basePath;
+  string _directory;
+public:
+  SpillStore(const string &basePath);
+  ~SpillStore();
+  // path of the named spill file, empty when no directory could be created
+  string path(const string &name);
+  bool write(const string &name, const uint8_t *data, size_t length);
+  // replaces the contents of buffer with the file
+  bool read(const string &name, bb::ByteBuffer &buffer);
+  // appends the file to out a chunk at a time
+  bool copyTo(const string &name, ostream &out);
+  void remove(const string &name);
+};
+
+#endif /* SpillStore_hpp */
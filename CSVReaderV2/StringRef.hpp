@@ -0,0 +1,52 @@
+//
+//  StringRef.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef StringRef_hpp
+#define StringRef_hpp
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+using namespace std;
+
+// Non owning view of characters that live somewhere stable, usually an
+// Arena, so hash sets and tables don't need a heap string per key.
+struct StringRef
+{
+  const char *data;
+  size_t size;
+  
+  StringRef() : data(nullptr), size(0) {}
+  StringRef(const char *data, size_t size) : data(data), size(size) {}
+  
+  string str() const { return string(data, size); }
+  bool operator==(const StringRef &other) const {
+    return size == other.size && (size == 0 || memcmp(data, other.data, size) == 0);
+  }
+  bool operator!=(const StringRef &other) const { return !(*this == other); }
+  bool operator<(const StringRef &other) const {
+    int result = memcmp(data, other.data, size < other.size ? size : other.size);
+    return result < 0 || (result == 0 && size < other.size);
+  }
+};
+
+// FNV-1a, short keys dominate so anything fancier doesn't pay off
+struct StringRefHash
+{
+  size_t operator()(const StringRef &ref) const {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < ref.size; ++i) {
+      hash ^= (unsigned char)ref.data[i];
+      hash *= 1099511628211ULL;
+    }
+    return (size_t)hash;
+  }
+};
+
+#endif /* StringRef_hpp */
@@ -0,0 +1,250 @@
+//
+//  TextHygiene.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "TextHygiene.hpp"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <tmmintrin.h>
+#define TEXT_HYGIENE_SSSE3 1
+static bool _hasSSSE3 = __builtin_cpu_supports("ssse3");
+#endif
+
+static const char kByteOrderMark[] = "\xEF\xBB\xBF";
+
+static inline bool _isControl(unsigned char c)
+{
+  return (c < 0x20 && c != '\t' && c != '\r' && c != '\n') || c == 0x7F;
+}
+
+// length of the UTF-8 sequence at data, 0 when it is invalid or cut off
+static size_t _sequenceLength(const unsigned char *data, size_t length)
+{
+  unsigned char c = data[0];
+  if (c < 0x80) {
+    return 1;
+  }
+  size_t size;
+  unsigned char low = 0x80, high = 0xBF;
+  if (c >= 0xC2 && c <= 0xDF) {
+    size = 2;
+  } else if (c >= 0xE0 && c <= 0xEF) {
+    size = 3;
+    low = c == 0xE0 ? 0xA0 : 0x80;
+    high = c == 0xED ? 0x9F : 0xBF;
+  } else if (c >= 0xF0 && c <= 0xF4) {
+    size = 4;
+    low = c == 0xF0 ? 0x90 : 0x80;
+    high = c == 0xF4 ? 0x8F : 0xBF;
+  } else {
+    return 0;
+  }
+  if (size > length || data[1] < low || data[1] > high) {
+    return 0;
+  }
+  for (size_t i = 2; i < size; ++i) {
+    if (data[i] < 0x80 || data[i] > 0xBF) {
+      return 0;
+    }
+  }
+  return size;
+}
+
+static void _scanScalar(const unsigned char *data, size_t length, TextScan &scan)
+{
+  size_t position = 0;
+  while (position < length) {
+    // eight plain printable ASCII bytes at once
+    if (position + 8 <= length) {
+      uint64_t word;
+      memcpy(&word, data + position, 8);
+      uint64_t belowSpace = (word - 0x2020202020202020ULL) & ~word;
+      uint64_t isDelete = ((word ^ 0x7F7F7F7F7F7F7F7FULL) - 0x0101010101010101ULL) & ~(word ^ 0x7F7F7F7F7F7F7F7FULL);
+      if (((word | belowSpace | isDelete) & 0x8080808080808080ULL) == 0) {
+        position += 8;
+        continue;
+      }
+    }
+    unsigned char c = data[position];
+    if (c < 0x80) {
+      scan.needsCleaning = scan.needsCleaning || _isControl(c);
+      position++;
+      continue;
+    }
+    size_t size = _sequenceLength(data + position, length - position);
+    if (size == 0) {
+      scan.invalidOffset = position;
+      return;
+    }
+    scan.needsCleaning = scan.needsCleaning || memcmp(data + position, kByteOrderMark, 3) == 0;
+    position += size;
+  }
+}
+
+#if TEXT_HYGIENE_SSSE3
+// The lookup algorithm of Keiser and Lemire: three table lookups on the high
+// and low nibbles of each byte and the one before it classify every error
+// of a two byte window, a saturating compare catches the continuation bytes
+// of three and four byte sequences.
+__attribute__((target("ssse3")))
+static bool _validateSSSE3(const unsigned char *data, size_t length, bool &needsCleaning)
+{
+  const uint8_t TOO_SHORT = 1 << 0, TOO_LONG = 1 << 1, OVERLONG_3 = 1 << 2, TOO_LARGE = 1 << 3;
+  const uint8_t SURROGATE = 1 << 4, OVERLONG_2 = 1 << 5, TOO_LARGE_1000 = 1 << 6, OVERLONG_4 = 1 << 6;
+  const uint8_t TWO_CONTS = 1 << 7, CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+  const __m128i byte1High = _mm_setr_epi8(TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+                                          TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+                                          TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+                                          TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+  const __m128i byte1Low = _mm_setr_epi8(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, CARRY | OVERLONG_2, CARRY, CARRY,
+                                         CARRY | TOO_LARGE, CARRY | TOO_LARGE | TOO_LARGE_1000,
+                                         CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+                                         CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+                                         CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+                                         CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+                                         CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000);
+  const __m128i byte2High = _mm_setr_epi8(TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+                                          TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+                                          TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+                                          TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                                          TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+                                          TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  // the last three bytes of a block may not start a sequence that runs past it
+  const __m128i incompleteLimit = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i del = _mm_set1_epi8(0x7F);
+
+  __m128i error = _mm_setzero_si128();
+  __m128i previous = _mm_setzero_si128();
+  __m128i previousIncomplete = _mm_setzero_si128();
+  __m128i special = _mm_setzero_si128();
+  unsigned char tail[16];
+  for (size_t position = 0; position < length; position += 16) {
+    __m128i input;
+    if (position + 16 <= length) {
+      input = _mm_loadu_si128((const __m128i *)(data + position));
+    } else {
+      // padding with spaces keeps the end of the data from counting as cut off
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, data + position, length - position);
+      input = _mm_loadu_si128((const __m128i *)tail);
+    }
+    // controls and DEL, the signed compare also flags every byte >= 0x80
+    __m128i lowBytes = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(input, tab), _mm_or_si128(_mm_cmpeq_epi8(input, cr), _mm_cmpeq_epi8(input, lf))),
+                                        _mm_cmplt_epi8(input, space));
+    special = _mm_or_si128(special, _mm_cmpeq_epi8(input, del));
+    if (_mm_movemask_epi8(input) == 0) {
+      special = _mm_or_si128(special, lowBytes);
+      error = _mm_or_si128(error, previousIncomplete);
+      previous = input;
+      continue;
+    }
+    special = _mm_or_si128(special, _mm_andnot_si128(input, lowBytes));
+    __m128i previous1 = _mm_alignr_epi8(input, previous, 15);
+    __m128i cases = _mm_and_si128(_mm_and_si128(_mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(previous1, 4), nibble)),
+                                                _mm_shuffle_epi8(byte1Low, _mm_and_si128(previous1, nibble))),
+                                  _mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+    __m128i previous2 = _mm_alignr_epi8(input, previous, 14);
+    __m128i previous3 = _mm_alignr_epi8(input, previous, 13);
+    __m128i bom = _mm_and_si128(_mm_cmpeq_epi8(previous2, _mm_set1_epi8((char)0xEF)),
+                                _mm_and_si128(_mm_cmpeq_epi8(previous1, _mm_set1_epi8((char)0xBB)), _mm_cmpeq_epi8(input, _mm_set1_epi8((char)0xBF))));
+    special = _mm_or_si128(special, bom);
+    __m128i isThird = _mm_subs_epu8(previous2, _mm_set1_epi8((char)(0xE0 - 0x80)));
+    __m128i isFourth = _mm_subs_epu8(previous3, _mm_set1_epi8((char)(0xF0 - 0x80)));
+    __m128i must23 = _mm_and_si128(_mm_or_si128(isThird, isFourth), _mm_set1_epi8((char)0x80));
+    error = _mm_or_si128(error, _mm_xor_si128(must23, cases));
+    previousIncomplete = _mm_subs_epu8(input, incompleteLimit);
+    previous = input;
+  }
+  error = _mm_or_si128(error, previousIncomplete);
+  needsCleaning = _mm_movemask_epi8(special) != 0;
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+TextScan scanText(const char *data, size_t length)
+{
+  TextScan scan;
+  const unsigned char *bytes = (const unsigned char *)data;
+#if TEXT_HYGIENE_SSSE3
+  if (_hasSSSE3) {
+    bool needsCleaning = false;
+    if (_validateSSSE3(bytes, length, needsCleaning) && !needsCleaning) {
+      return scan;
+    }
+    // the vector pass only knows that something is off, let the byte loop find out where
+  }
+#endif
+  _scanScalar(bytes, length, scan);
+  return scan;
+}
+
+bool stripByteOrderMark(string &content)
+{
+  if (content.compare(0, 3, kByteOrderMark) == 0) {
+    content.erase(0, 3);
+    return true;
+  }
+  return false;
+}
+
+void sanitizeCell(string &cell, TextPolicy policy, bool needsCleaning)
+{
+  if (!needsCleaning && policy == DataText) {
+    return;
+  }
+  size_t out = 0;
+  for (size_t i = 0; i < cell.size(); ++i) {
+    unsigned char c = cell[i];
+    if (c < 0x20 || c == 0x7F) {
+      continue;
+    }
+    if (c == 0xEF && cell.compare(i, 3, kByteOrderMark) == 0) {
+      i += 2;
+      continue;
+    }
+    cell[out++] = c;
+  }
+  cell.resize(out);
+  if (policy == HeaderText) {
+    size_t begin = cell.find_first_not_of(' ');
+    if (begin == string::npos) {
+      cell.clear();
+    } else {
+      cell = cell.substr(begin, cell.find_last_not_of(' ') - begin + 1);
+    }
+  }
+}
+
+bool isAsciiText(const string &text)
+{
+  for (unsigned char c : text) {
+    if (c >= 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int lineOfOffset(const string &content, size_t offset)
+{
+  int line = 1;
+  for (size_t i = 0; i < offset && i < content.size(); ++i) {
+    char c = content[i];
+    if (c == '\n' || (c == '\r' && (i + 1 == content.size() || content[i + 1] != '\n'))) {
+      line++;
+    }
+  }
+  return line;
+}
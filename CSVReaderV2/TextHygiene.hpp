@@ -0,0 +1,52 @@
+//
+//  TextHygiene.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef TextHygiene_hpp
+#define TextHygiene_hpp
+
+#include <stdio.h>
+#include <string>
+
+using namespace std;
+
+// Result of one pass over a source file
+struct TextScan
+{
+  // offset of the first byte that isn't part of valid UTF-8, npos when all of it is
+  size_t invalidOffset = string::npos;
+  // control characters other than tab, CR and LF or a byte order mark somewhere,
+  // cells only have to be cleaned when this is set
+  bool needsCleaning = false;
+};
+
+// Validates UTF-8 16 bytes at a time where the CPU allows it, plain ASCII
+// runs are skipped without looking at single bytes.
+TextScan scanText(const char *data, size_t length);
+
+// removes a leading UTF-8 byte order mark, returns true if there was one
+bool stripByteOrderMark(string &content);
+
+enum TextPolicy
+{
+  // header and type cells: control characters and BOMs are dropped, spaces trimmed
+  HeaderText,
+  // data cells: control characters and BOMs are dropped, everything else is kept
+  DataText,
+};
+
+// needsCleaning is TextScan::needsCleaning of the text the cell came from,
+// data cells of clean text are left alone without looking at them
+void sanitizeCell(string &cell, TextPolicy policy, bool needsCleaning = true);
+
+// true when text is plain ASCII, which header cells of generated properties have to be
+bool isAsciiText(const string &text);
+
+// 1 based line of offset, CR, LF and CRLF each end a line
+int lineOfOffset(const string &content, size_t offset);
+
+#endif /* TextHygiene_hpp */
@@ -0,0 +1,44 @@
+//
+//  Validator.cpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#include "Validator.hpp"
+
+Validator::Validator(const string &fileName) : _keys(16 * 1024)
+{
+  _fileName = fileName;
+}
+
+void Validator::error(int row, int column, const string &message)
+{
+  _errors.push_back({_fileName, row, column, message});
+}
+
+bool Validator::insertUnique(StringRefSet &keys, const string &key, int row, int column, const string &what)
+{
+  StringRef ref(key.data(), key.size());
+  if (keys.count(ref)) {
+    error(row, column, "duplicate " + what + " '" + key + "'");
+    return false;
+  }
+  keys.insert(_keys.copyString(key));
+  return true;
+}
+
+void printValidationErrors(ostream &os, const vector<ValidationError> &errors)
+{
+  for (const ValidationError &error : errors) {
+    os << error.fileName;
+    if (error.row > 0) {
+      os << ":" << error.row;
+      if (error.column > 0) {
+        os << ":" << error.column;
+      }
+    }
+    os << ": error: " << error.message << endl;
+  }
+}
@@ -0,0 +1,56 @@
+//
+//  Validator.hpp
+//  CSVReaderV2
+//
+//  Created by Yujie Liu on 10/19/26.
+//  Copyright © 2017 Yujie Liu. All rights reserved.
+//
+
+#ifndef Validator_hpp
+#define Validator_hpp
+
+#include <stdio.h>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "Arena.hpp"
+#include "StringRef.hpp"
+
+using namespace std;
+
+struct ValidationError
+{
+  string fileName;
+  // 1 based line and column in the source file, 0 when it covers the whole line or file
+  int row;
+  int column;
+  string message;
+};
+
+typedef unordered_set<StringRef, StringRefHash> StringRefSet;
+
+// Collects data errors of one source file while the converter parses it.
+// Unlike the asserts it replaces it stays on in release builds and doesn't
+// stop at the first problem, so one run reports everything wrong with a table.
+class Validator
+{
+private:
+  string _fileName;
+  vector<ValidationError> _errors;
+  // backs the keys of every StringRefSet filled through this validator
+  Arena _keys;
+public:
+  Validator(const string &fileName);
+  
+  void error(int row, int column, const string &message);
+  // adds key to keys, returns false and records an error if it was already there
+  bool insertUnique(StringRefSet &keys, const string &key, int row, int column, const string &what);
+  
+  bool hasErrors() const { return _errors.size() > 0; }
+  const vector<ValidationError> &errors() const { return _errors; }
+};
+
+void printValidationErrors(ostream &os, const vector<ValidationError> &errors);
+
+#endif /* Validator_hpp */